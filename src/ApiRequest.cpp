@@ -0,0 +1,124 @@
+#include "ApiRequest.h"
+#include "Arduino.h"
+
+void ApiRequest::BeginCommand(const String& args)
+{
+    _command = true;
+    _args = args;
+    _responseCode = 0;
+    _responseBody = String();
+}
+
+void ApiRequest::EndCommand()
+{
+    _command = false;
+    _args = String();
+}
+
+int ApiRequest::GetResponseCode()
+{
+    return _responseCode;
+}
+
+const String& ApiRequest::GetResponseBody()
+{
+    return _responseBody;
+}
+
+bool ApiRequest::hasArg(const String& name)
+{
+    if(!_command)
+    {
+        return _server.hasArg(name);
+    }
+
+    String value;
+
+    return FindArg(name, value);
+}
+
+String ApiRequest::arg(const String& name)
+{
+    if(!_command)
+    {
+        return _server.arg(name);
+    }
+
+    String value;
+    FindArg(name, value);
+
+    return value;
+}
+
+void ApiRequest::send(int code, const char* contentType, const String& content)
+{
+    if(!_command)
+    {
+        _server.send(code, contentType, content);
+        return;
+    }
+
+    _responseCode = code;
+    _responseBody = content;
+}
+
+//A command carries no headers, the handler sees them as missing
+String ApiRequest::header(const String& name)
+{
+    return _command ? String() : _server.header(name);
+}
+
+//For binary bodies that may contain zero bytes
+void ApiRequest::send(int code, const char* contentType, const char* content, size_t length)
+{
+    if(!_command)
+    {
+        _server.send(code, contentType, content, length);
+        return;
+    }
+
+    _responseCode = code;
+    _responseBody = String();
+    _responseBody.concat(content, length);
+}
+
+//Headers such as Retry-After only mean something over HTTP
+void ApiRequest::sendHeader(const String& name, const String& value)
+{
+    if(!_command)
+    {
+        _server.sendHeader(name, value);
+    }
+}
+
+bool ApiRequest::FindArg(const String& name, String& value)
+{
+    int start = 0;
+
+    while(start < (int)_args.length())
+    {
+        int end = _args.indexOf('&', start);
+
+        if(end < 0)
+        {
+            end = _args.length();
+        }
+
+        int equals = _args.indexOf('=', start);
+
+        if(equals < 0 || equals > end)
+        {
+            equals = end;
+        }
+
+        if(_args.substring(start, equals) == name)
+        {
+            value = equals < end ? _urlDecoder.urldecode(_args.substring(equals + 1, end)) : String();
+            return true;
+        }
+
+        start = end + 1;
+    }
+
+    return false;
+}
@@ -0,0 +1,38 @@
+#ifndef ApiRequest_h
+#define ApiRequest_h
+#include "Arduino.h"
+#include "UrlEncoderDecoder.h"
+#include <ESP8266WebServer.h>
+
+//Lets the same handlers serve HTTP requests and MQTT commands. Outside a command everything goes to the web
+//server, during one the arguments come from the command payload ("name=value&...") and the response is kept.
+//Method names follow ESP8266WebServer so handlers read the same either way.
+class ApiRequest
+{
+    public:
+        ApiRequest(ESP8266WebServer& server) : _server(server) {}
+
+        void BeginCommand(const String& args);
+        void EndCommand();
+        int GetResponseCode();
+        const String& GetResponseBody();
+
+        bool hasArg(const String& name);
+        String arg(const String& name);
+        String header(const String& name);
+        void send(int code, const char* contentType, const String& content = String());
+        void send(int code, const char* contentType, const char* content, size_t length);
+        void sendHeader(const String& name, const String& value);
+
+    private:
+        ESP8266WebServer& _server;
+        UrlEncoderDecoderService _urlDecoder;
+        bool _command = false;
+        String _args;
+        int _responseCode = 0;
+        String _responseBody;
+
+        bool FindArg(const String& name, String& value);
+};
+
+#endif
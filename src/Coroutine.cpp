@@ -0,0 +1,9 @@
+#include "Coroutine.h"
+
+#ifdef ARDUINO
+#include "Arduino.h"
+
+unsigned long (*Coroutine::clock)() = millis;
+#else
+unsigned long (*Coroutine::clock)() = nullptr; //host tests point it at their simulated clock
+#endif
@@ -0,0 +1,31 @@
+#ifndef Coroutine_h
+#define Coroutine_h
+
+//Stackless coroutine state: the line to resume at and the start of the current delay. Locals do not survive a
+//yield, anything needed after one has to live outside the function.
+struct Coroutine
+{
+    unsigned int line = 0;
+    unsigned long waitStartMillis = 0;
+
+    void Restart() { line = 0; }
+    bool IsStarted() { return line != 0; }
+
+    //millis() by default. main.cpp points it at the clock that carries over deep sleep, host tests at a simulated one
+    static unsigned long (*clock)();
+};
+
+//A coroutine is a function returning bool, true once it ran to the end. Its body goes between COROUTINE_BEGIN
+//and COROUTINE_END and it resumes where it yielded on the next call. Two waits may not share a source line,
+//and a wait may not sit inside a switch of its own.
+#define COROUTINE_BEGIN(coroutine) switch((coroutine).line) { case 0:
+
+#define COROUTINE_YIELD(coroutine) do { (coroutine).line = __LINE__; return false; case __LINE__:; } while(0)
+
+#define COROUTINE_WAIT_UNTIL(coroutine, condition) do { (coroutine).line = __LINE__; case __LINE__: if(!(condition)) return false; } while(0)
+
+#define COROUTINE_DELAY(coroutine, delayMillis) do { (coroutine).waitStartMillis = Coroutine::clock(); (coroutine).line = __LINE__; case __LINE__: if(Coroutine::clock() - (coroutine).waitStartMillis < (delayMillis)) return false; } while(0)
+
+#define COROUTINE_END(coroutine) } (coroutine).line = 0; return true
+
+#endif
@@ -0,0 +1,96 @@
+#include "DryingRateEstimator.h"
+
+void DryingRateEstimator::AddReading(unsigned long readingMillis, double reading)
+{
+    _millis[_next] = readingMillis;
+    _readings[_next] = reading;
+    _next = (_next + 1) % dryingRateHistorySize;
+
+    if(_count < dryingRateHistorySize)
+    {
+        _count++;
+    }
+}
+
+void DryingRateEstimator::Reset()
+{
+    _count = 0;
+    _next = 0;
+}
+
+bool DryingRateEstimator::GetSlopePerMinute(double& slope)
+{
+    if(_count < 2)
+    {
+        return false;
+    }
+
+    //Oldest entry first, times relative to it so the sums stay small
+    uint8_t oldest = (_next + dryingRateHistorySize - _count) % dryingRateHistorySize;
+    double sumX = 0;
+    double sumY = 0;
+    double sumXX = 0;
+    double sumXY = 0;
+
+    for(uint8_t i = 0; i < _count; i++)
+    {
+        uint8_t index = (oldest + i) % dryingRateHistorySize;
+        double x = (_millis[index] - _millis[oldest]) / 60000.0;
+        double y = _readings[index];
+
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+    }
+
+    double denominator = _count * sumXX - sumX * sumX;
+
+    if(denominator <= 0)
+    {
+        return false;
+    }
+
+    slope = (_count * sumXY - sumX * sumY) / denominator;
+
+    return true;
+}
+
+unsigned long DryingRateEstimator::PredictNextIntervalMillis(double threshold, unsigned long minIntervalMillis, unsigned long maxIntervalMillis)
+{
+    double slope;
+
+    //Not enough history for a slope, no prediction
+    if(!GetSlopePerMinute(slope))
+    {
+        return 0;
+    }
+
+    //The soil is not drying, nothing to hurry for
+    if(slope <= 0)
+    {
+        return maxIntervalMillis;
+    }
+
+    double latestReading = _readings[(_next + dryingRateHistorySize - 1) % dryingRateHistorySize];
+
+    if(latestReading >= threshold)
+    {
+        return minIntervalMillis;
+    }
+
+    double minutesToThreshold = (threshold - latestReading) / slope;
+    double intervalMillis = minutesToThreshold * predictionMarginFraction * 60000.0;
+
+    if(intervalMillis < minIntervalMillis)
+    {
+        return minIntervalMillis;
+    }
+
+    if(intervalMillis > maxIntervalMillis)
+    {
+        return maxIntervalMillis;
+    }
+
+    return intervalMillis;
+}
@@ -0,0 +1,26 @@
+#ifndef DryingRateEstimator_h
+#define DryingRateEstimator_h
+#include <stdint.h>
+
+#define dryingRateHistorySize 8 //readings since the last watering used for the slope fit
+#define predictionMarginFraction 0.8 //measure this far into the predicted time to the threshold, so the crossing is not overshot
+
+//Least squares fit of the soil reading over time since the last watering, used to predict when the threshold is crossed.
+//The history is a ring, a long dry spell is fitted on its latest readings only.
+class DryingRateEstimator
+{
+    public:
+        void AddReading(unsigned long readingMillis, double reading);
+        void Reset();
+        bool GetSlopePerMinute(double& slope);
+        //0 until two readings give a slope, the caller then uses its fixed interval
+        unsigned long PredictNextIntervalMillis(double threshold, unsigned long minIntervalMillis, unsigned long maxIntervalMillis);
+
+    private:
+        unsigned long _millis[dryingRateHistorySize];
+        double _readings[dryingRateHistorySize];
+        uint8_t _count = 0;
+        uint8_t _next = 0;
+};
+
+#endif
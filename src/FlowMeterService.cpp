@@ -0,0 +1,33 @@
+#include "FlowMeterService.h"
+
+volatile unsigned long FlowMeterService::_pulses = 0;
+
+void IRAM_ATTR FlowMeterService::OnPulse()
+{
+    _pulses++;
+}
+
+void FlowMeterService::Begin(int gpio)
+{
+#ifdef ARDUINO
+    pinMode(gpio, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(gpio), OnPulse, FALLING);
+#else
+    (void)gpio;
+#endif
+}
+
+void FlowMeterService::ResetPulses()
+{
+    _pulses = 0;
+}
+
+unsigned long FlowMeterService::GetPulses()
+{
+    return _pulses;
+}
+
+double FlowMeterService::GetMillilitres(double pulsesPerLitre)
+{
+    return _pulses * 1000.0 / pulsesPerLitre;
+}
@@ -0,0 +1,26 @@
+#ifndef FlowMeterService_h
+#define FlowMeterService_h
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+#define IRAM_ATTR //host tests feed simulated pulses to OnPulse()
+#endif
+
+//Counts pulses of a hall effect flow sensor (e.g. YF-S201) in an interrupt
+class FlowMeterService
+{
+    public:
+        void Begin(int gpio);
+        void ResetPulses();
+        unsigned long GetPulses();
+        double GetMillilitres(double pulsesPerLitre);
+
+        //Called by the pin interrupt, a simulated pulse source can call it directly
+        static void IRAM_ATTR OnPulse();
+
+    private:
+        static volatile unsigned long _pulses;
+};
+
+#endif
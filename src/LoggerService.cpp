@@ -0,0 +1,88 @@
+#include "LoggerService.h"
+#include "Arduino.h"
+#include <stdarg.h>
+
+void LoggerService::Log(byte level, PGM_P format, ...)
+{
+    static const char levelPrefixes[] PROGMEM = "DIWE";
+
+    char message[loggerMaxMessageLength];
+    int length = snprintf_P(message, sizeof(message), PSTR("%lu [%c] "), millis(), pgm_read_byte(levelPrefixes + level));
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf_P(message + length, sizeof(message) - length, format, args);
+    va_end(args);
+
+    print(message);
+    print('\n');
+}
+
+size_t LoggerService::write(uint8_t c)
+{
+    _buffer[_head & (loggerBufferSize - 1)] = c;
+    _head++;
+
+    //The UART could not keep up, drop the oldest unsent byte
+    if(_head - _tail > loggerBufferSize)
+    {
+        _tail = _head - loggerBufferSize;
+        _droppedBytes++;
+    }
+
+    return 1;
+}
+
+size_t LoggerService::write(const uint8_t* buffer, size_t size)
+{
+    for(size_t i = 0; i < size; i++)
+    {
+        write(buffer[i]);
+    }
+
+    return size;
+}
+
+void LoggerService::Drain(HardwareSerial& output)
+{
+    //Only hand the UART what fits in its FIFO, so this never blocks
+    int available = output.availableForWrite();
+
+    while(available > 0 && _tail != _head)
+    {
+        output.write(_buffer[_tail & (loggerBufferSize - 1)]);
+        _tail++;
+        available--;
+    }
+}
+
+String LoggerService::GetRecentLogs()
+{
+    unsigned long length = _head < loggerBufferSize ? _head : loggerBufferSize;
+    unsigned long start = _head - length;
+
+    String logs;
+    logs.reserve(length);
+
+    //Skip the partially overwritten first line
+    if(start > 0)
+    {
+        while(start != _head && _buffer[start & (loggerBufferSize - 1)] != '\n')
+        {
+            start++;
+        }
+        start++;
+    }
+
+    for(unsigned long i = start; i < _head; i++)
+    {
+        logs += _buffer[i & (loggerBufferSize - 1)];
+    }
+
+    return logs;
+}
+
+unsigned long LoggerService::GetDroppedBytes()
+{
+    return _droppedBytes;
+}
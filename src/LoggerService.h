@@ -0,0 +1,63 @@
+#ifndef LoggerService_h
+#define LoggerService_h
+#include "Arduino.h"
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE 4
+
+//Messages below this level are removed at compile time, override with -D LOG_LEVEL=... in platformio.ini
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define loggerBufferSize 1024 //Must be a power of two
+#define loggerMaxMessageLength 128
+
+//Formats messages into a ring buffer which is drained to the UART from loop(),
+//so logging never waits for the 9600 baud serial line
+class LoggerService : public Print
+{
+    public:
+        void Log(byte level, PGM_P format, ...);
+        void Drain(HardwareSerial& output);
+        String GetRecentLogs();
+        unsigned long GetDroppedBytes();
+
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t* buffer, size_t size) override;
+
+    private:
+        char _buffer[loggerBufferSize];
+        unsigned long _head = 0; //total bytes written
+        unsigned long _tail = 0; //total bytes sent to the UART
+        unsigned long _droppedBytes = 0;
+};
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(logger, format, ...) (logger).Log(LOG_LEVEL_DEBUG, PSTR(format), ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(logger, format, ...) do {} while(0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(logger, format, ...) (logger).Log(LOG_LEVEL_INFO, PSTR(format), ##__VA_ARGS__)
+#else
+#define LOG_INFO(logger, format, ...) do {} while(0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARNING
+#define LOG_WARNING(logger, format, ...) (logger).Log(LOG_LEVEL_WARNING, PSTR(format), ##__VA_ARGS__)
+#else
+#define LOG_WARNING(logger, format, ...) do {} while(0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(logger, format, ...) (logger).Log(LOG_LEVEL_ERROR, PSTR(format), ##__VA_ARGS__)
+#else
+#define LOG_ERROR(logger, format, ...) do {} while(0)
+#endif
+
+#endif
@@ -1,7 +1,6 @@
 #include "MathService.h"
-#include "Arduino.h"
 
-unsigned long MathService::ConvertMinutesToMillis(byte minutes)
+unsigned long MathService::ConvertMinutesToMillis(uint8_t minutes)
 {
     return 60000 * minutes;
 }
@@ -1,11 +1,11 @@
 #ifndef MathService_h
 #define MathService_h
-#include "Arduino.h"
+#include <stdint.h>
 
 class MathService
 {
     public:
-        unsigned long ConvertMinutesToMillis(byte minutes);
+        unsigned long ConvertMinutesToMillis(uint8_t minutes);
         unsigned long ConvertSecondsToMillis(int seconds);
         double ConvertMillisToHours(unsigned long millis);
         double ConvertMillisToDays(unsigned long millis);
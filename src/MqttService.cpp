@@ -0,0 +1,195 @@
+#include "MqttService.h"
+#include "Arduino.h"
+#include <ESP8266WiFi.h>
+
+void MqttService::Begin(const String& broker, uint16_t port, const String& baseTopic, MqttCommandHandler commandHandler)
+{
+    _broker = broker;
+    _port = port;
+    _baseTopic = baseTopic;
+    _commandHandler = commandHandler;
+
+    _wifiClient.setTimeout(mqttConnectTimeoutMillis);
+    _client.setClient(_wifiClient);
+    _client.setBufferSize(mqttBufferSize);
+    _client.setSocketTimeout(mqttConnectTimeoutMillis / 1000);
+    _client.setCallback([this](char* topic, byte* payload, unsigned int length) { OnMessage(topic, payload, length); });
+}
+
+void MqttService::Loop()
+{
+    if(_broker.length() == 0 || WiFi.status() != WL_CONNECTED)
+    {
+        return;
+    }
+
+    if(!_client.connected())
+    {
+        if((long)(millis() - _nextConnectMillis) < 0)
+        {
+            return;
+        }
+
+        if(!Connect())
+        {
+            _nextConnectMillis = millis() + _reconnectMillis;
+            _reconnectMillis = min(_reconnectMillis * 2, (unsigned long)mqttMaxReconnectMillis);
+            return;
+        }
+
+        _reconnectMillis = mqttMinReconnectMillis;
+    }
+
+    _client.loop();
+    FlushQueue();
+}
+
+bool MqttService::Connect()
+{
+    if(!ResolveBroker())
+    {
+        return false;
+    }
+
+    String clientId = "selfwatering-" + String(ESP.getChipId(), HEX);
+    String statusTopic = _baseTopic + "/status";
+
+    //The broker publishes "offline" for us when the connection drops without a disconnect
+    if(!_client.connect(clientId.c_str(), statusTopic.c_str(), 1, true, "offline"))
+    {
+        _brokerIp.clear(); //looked up again on the next attempt, the broker may have moved
+        return false;
+    }
+
+    _connects++;
+    _client.publish(statusTopic.c_str(), "online", true);
+    _client.subscribe((_baseTopic + "/cmd/+").c_str(), 1);
+
+    return true;
+}
+
+//The SDK lookup otherwise waits up to 10 s for the DNS server, outside the connect timeout
+bool MqttService::ResolveBroker()
+{
+    if(_brokerIp.isSet())
+    {
+        return true;
+    }
+
+    if(!_brokerIp.fromString(_broker) && !WiFi.hostByName(_broker.c_str(), _brokerIp, mqttConnectTimeoutMillis))
+    {
+        _brokerIp.clear();
+        return false;
+    }
+
+    _client.setServer(_brokerIp, _port);
+
+    return true;
+}
+
+//Queued while disconnected and sent in order once connected. QoS 0 on the wire, PubSubClient cannot publish QoS 1.
+bool MqttService::Publish(const String& subtopic, const String& payload, bool retained)
+{
+    if(_broker.length() == 0)
+    {
+        return false;
+    }
+
+    if(!_client.connected() || _queueCount > 0)
+    {
+        Enqueue(subtopic, payload, retained);
+        return false;
+    }
+
+    if(!_client.publish((_baseTopic + "/" + subtopic).c_str(), payload.c_str(), retained))
+    {
+        Enqueue(subtopic, payload, retained);
+        return false;
+    }
+
+    _published++;
+
+    return true;
+}
+
+void MqttService::Enqueue(const String& subtopic, const String& payload, bool retained)
+{
+    if(_queueCount == mqttOfflineQueueSize)
+    {
+        _queueStart = (_queueStart + 1) % mqttOfflineQueueSize;
+        _queueCount--;
+        _dropped++;
+    }
+
+    Message& message = _queue[(_queueStart + _queueCount) % mqttOfflineQueueSize];
+    message.subtopic = subtopic;
+    message.payload = payload;
+    message.retained = retained;
+    _queueCount++;
+}
+
+void MqttService::FlushQueue()
+{
+    for(byte sent = 0; sent < mqttMaxFlushPerLoop && _queueCount > 0 && _client.connected(); sent++)
+    {
+        Message& message = _queue[_queueStart];
+
+        if(!_client.publish((_baseTopic + "/" + message.subtopic).c_str(), message.payload.c_str(), message.retained))
+        {
+            return;
+        }
+
+        message.subtopic = String();
+        message.payload = String();
+        _queueStart = (_queueStart + 1) % mqttOfflineQueueSize;
+        _queueCount--;
+        _published++;
+    }
+}
+
+void MqttService::OnMessage(char* topic, byte* payload, unsigned int length)
+{
+    String commandPrefix = _baseTopic + "/cmd/";
+    String topicString = topic;
+
+    if(_commandHandler == nullptr || !topicString.startsWith(commandPrefix))
+    {
+        return;
+    }
+
+    //Copied out first, publishing from the handler reuses the buffer payload points into
+    String payloadString;
+    payloadString.reserve(length);
+
+    for(unsigned int i = 0; i < length; i++)
+    {
+        payloadString += (char)payload[i];
+    }
+
+    _commandHandler(topicString.substring(commandPrefix.length()), payloadString);
+}
+
+bool MqttService::IsConnected()
+{
+    return _client.connected();
+}
+
+unsigned long MqttService::GetPublished()
+{
+    return _published;
+}
+
+unsigned long MqttService::GetDropped()
+{
+    return _dropped;
+}
+
+unsigned long MqttService::GetConnects()
+{
+    return _connects;
+}
+
+byte MqttService::GetQueued()
+{
+    return _queueCount;
+}
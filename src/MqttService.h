@@ -0,0 +1,62 @@
+#ifndef MqttService_h
+#define MqttService_h
+#include "Arduino.h"
+#include <WiFiClient.h>
+#include <PubSubClient.h>
+
+#define mqttOfflineQueueSize 8 //messages kept while the broker is unreachable, the oldest is dropped first
+#define mqttMaxFlushPerLoop 4 //queued messages sent per Loop() call, so a long queue does not hold up the tick
+#define mqttConnectTimeoutMillis 1000 //the broker lookup and a connect attempt each block the loop at most this long
+#define mqttMinReconnectMillis 5000
+#define mqttMaxReconnectMillis 60000
+#define mqttBufferSize 512
+
+typedef void (*MqttCommandHandler)(const String& command, const String& payload);
+
+//Publishes under baseTopic and passes messages on baseTopic/cmd/<command> to the command handler.
+//Never waits for the broker: Loop() makes at most one short connect attempt, with a growing delay between attempts.
+class MqttService
+{
+    public:
+        void Begin(const String& broker, uint16_t port, const String& baseTopic, MqttCommandHandler commandHandler);
+        void Loop();
+        bool Publish(const String& subtopic, const String& payload, bool retained = false);
+        bool IsConnected();
+
+        unsigned long GetPublished();
+        unsigned long GetDropped();
+        unsigned long GetConnects();
+        byte GetQueued();
+
+    private:
+        struct Message
+        {
+            String subtopic;
+            String payload;
+            bool retained;
+        };
+
+        WiFiClient _wifiClient;
+        PubSubClient _client;
+        String _broker;
+        uint16_t _port = 0;
+        IPAddress _brokerIp; //resolved once, PubSubClient would look the name up on every attempt without a timeout
+        String _baseTopic;
+        MqttCommandHandler _commandHandler = nullptr;
+        Message _queue[mqttOfflineQueueSize];
+        byte _queueStart = 0;
+        byte _queueCount = 0;
+        unsigned long _nextConnectMillis = 0;
+        unsigned long _reconnectMillis = mqttMinReconnectMillis;
+        unsigned long _published = 0;
+        unsigned long _dropped = 0;
+        unsigned long _connects = 0;
+
+        bool Connect();
+        bool ResolveBroker();
+        void Enqueue(const String& subtopic, const String& payload, bool retained);
+        void FlushQueue();
+        void OnMessage(char* topic, byte* payload, unsigned int length);
+};
+
+#endif
@@ -0,0 +1,7 @@
+#include "MultiplexerService.h"
+
+void MultiplexerService::SelectChannel(uint8_t channel, const DigitalOutput& select0, const DigitalOutput& select1)
+{
+    channel & 0x01 ? select0.high() : select0.low();
+    channel & 0x02 ? select1.high() : select1.low();
+}
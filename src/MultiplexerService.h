@@ -0,0 +1,12 @@
+#ifndef MultiplexerService_h
+#define MultiplexerService_h
+#include "OutputPin.h"
+
+//Routes one of up to four analog inputs to the single ESP8266 ADC (e.g. a CD74HC4052 or one half of a 4067)
+class MultiplexerService
+{
+    public:
+        void SelectChannel(uint8_t channel, const DigitalOutput& select0, const DigitalOutput& select1);
+};
+
+#endif
@@ -0,0 +1,165 @@
+#include "NotificationService.h"
+#include "Arduino.h"
+
+void NotificationService::Begin(const String& gatewayUrl, const String& smsPath)
+{
+    _gatewayUrl = gatewayUrl;
+    _smsPath = smsPath;
+
+    //end() then leaves the connection open for the next request instead of closing it
+    _client.setReuse(true);
+}
+
+//False when the outbox is full, the message is dropped
+bool NotificationService::Queue(const String& message)
+{
+    if(_count >= notificationOutboxSize)
+    {
+        _dropped++;
+        return false;
+    }
+
+    _outbox[_count++] = message;
+
+    return true;
+}
+
+bool NotificationService::HasPending()
+{
+    return _count > 0;
+}
+
+//Sends everything queued as one SMS. True when the outbox is empty afterwards, a failure is retried
+//on a later call with a growing delay so an unreachable gateway does not block every tick.
+bool NotificationService::Flush()
+{
+    if(_count == 0)
+    {
+        return true;
+    }
+
+    if((long)(millis() - _nextAttemptMillis) < 0)
+    {
+        return false;
+    }
+
+    String batch = _outbox[0];
+
+    for(byte i = 1; i < _count; i++)
+    {
+        batch += '\n';
+        batch += _outbox[i];
+    }
+
+    int httpCode = Request(_smsPath + "?message=" + _urlEncoder.urlencode(batch), String(), nullptr);
+
+    if(httpCode < 200 || httpCode >= 300)
+    {
+        _failures++;
+        _nextAttemptMillis = millis() + _retryMillis;
+        _retryMillis = min(_retryMillis * 2, (unsigned long)maxNotificationRetryMillis);
+        return false;
+    }
+
+    _sent += _count;
+    _batches++;
+    _retryMillis = minNotificationRetryMillis;
+    Clear();
+
+    return true;
+}
+
+void NotificationService::Clear()
+{
+    for(byte i = 0; i < _count; i++)
+    {
+        _outbox[i] = String();
+    }
+
+    _count = 0;
+}
+
+int NotificationService::Post(const String& path, const String& body, const char* contentType)
+{
+    return Request(path, body, contentType);
+}
+
+//A reused connection can turn out to be closed only when writing to it, that request is repeated once on a new one
+int NotificationService::Request(const String& path, const String& body, const char* contentType)
+{
+    //Health check before reuse, an idle connection may have been closed by the gateway without us seeing the FIN
+    if(_wifiClient.connected() && millis() - _lastRequestMillis > gatewayIdleTimeoutMillis)
+    {
+        _wifiClient.stop();
+    }
+
+    bool reused = _wifiClient.connected();
+    int httpCode = SendOnce(path, body, contentType);
+
+    if(httpCode < 0 && reused)
+    {
+        _reconnects++;
+        _wifiClient.stop();
+        reused = false;
+        httpCode = SendOnce(path, body, contentType);
+    }
+
+    if(!reused)
+    {
+        _connections++;
+    }
+
+    if(httpCode < 0)
+    {
+        _wifiClient.stop();
+    }
+
+    _lastRequestMillis = millis();
+
+    return httpCode;
+}
+
+int NotificationService::SendOnce(const String& path, const String& body, const char* contentType)
+{
+    _client.begin(_wifiClient, _gatewayUrl + path);
+
+    if(contentType != nullptr)
+    {
+        _client.addHeader("Content-Type", contentType);
+    }
+
+    int httpCode = _client.sendRequest("POST", body);
+    _client.end();
+
+    return httpCode;
+}
+
+unsigned long NotificationService::GetSent()
+{
+    return _sent;
+}
+
+unsigned long NotificationService::GetBatches()
+{
+    return _batches;
+}
+
+unsigned long NotificationService::GetFailures()
+{
+    return _failures;
+}
+
+unsigned long NotificationService::GetDropped()
+{
+    return _dropped;
+}
+
+unsigned long NotificationService::GetConnections()
+{
+    return _connections;
+}
+
+unsigned long NotificationService::GetReconnects()
+{
+    return _reconnects;
+}
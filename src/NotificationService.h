@@ -0,0 +1,54 @@
+#ifndef NotificationService_h
+#define NotificationService_h
+#include "Arduino.h"
+#include "UrlEncoderDecoder.h"
+#include <ESP8266HttpClient.h>
+#include <WiFiClient.h>
+
+#define notificationOutboxSize 4 //one refill message per zone fits, numberOfZones is at most 4
+#define gatewayIdleTimeoutMillis 20000 //reconnect rather than reuse a connection the gateway may have closed in the meantime
+#define minNotificationRetryMillis 5000
+#define maxNotificationRetryMillis 300000
+
+//Sends SMS and other reports through the CSCS gateway over one reused keep-alive connection.
+//Queued messages are sent together, one per line, in a single request.
+class NotificationService
+{
+    public:
+        void Begin(const String& gatewayUrl, const String& smsPath);
+        bool Queue(const String& message);
+        bool HasPending();
+        bool Flush();
+        void Clear();
+        int Post(const String& path, const String& body, const char* contentType);
+
+        unsigned long GetSent();
+        unsigned long GetBatches();
+        unsigned long GetFailures();
+        unsigned long GetDropped();
+        unsigned long GetConnections();
+        unsigned long GetReconnects();
+
+    private:
+        HTTPClient _client;
+        WiFiClient _wifiClient;
+        UrlEncoderDecoderService _urlEncoder;
+        String _gatewayUrl;
+        String _smsPath;
+        String _outbox[notificationOutboxSize];
+        byte _count = 0;
+        unsigned long _lastRequestMillis = 0;
+        unsigned long _nextAttemptMillis = 0;
+        unsigned long _retryMillis = minNotificationRetryMillis;
+        unsigned long _sent = 0;
+        unsigned long _batches = 0;
+        unsigned long _failures = 0;
+        unsigned long _dropped = 0;
+        unsigned long _connections = 0;
+        unsigned long _reconnects = 0;
+
+        int Request(const String& path, const String& body, const char* contentType);
+        int SendOnce(const String& path, const String& body, const char* contentType);
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef OutputPin_h
+#define OutputPin_h
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+#include <stdint.h>
+#define OUTPUT 0x01
+#define LOW 0x0
+#define HIGH 0x1
+#endif
+
+//Compile-time output pin. On the ESP8266 High()/Low() are a single GPOS/GPOC register write,
+//no pin lookup or checks like digitalWrite(). Off target the writes go to MockGpio so logic can be run on the host.
+template <uint8_t Pin>
+class OutputPin
+{
+    static_assert(Pin <= 16, "ESP8266 only has GPIO 0-16");
+    static_assert(Pin < 6 || Pin > 11, "GPIO 6-11 are wired to the flash chip");
+
+    public:
+        static void Begin();
+        static void High();
+        static void Low();
+};
+
+#ifdef ARDUINO_ARCH_ESP8266
+
+template <uint8_t Pin>
+void OutputPin<Pin>::Begin()
+{
+    pinMode(Pin, OUTPUT);
+}
+
+template <uint8_t Pin>
+inline void IRAM_ATTR OutputPin<Pin>::High()
+{
+    GPOS = (1 << Pin);
+}
+
+template <uint8_t Pin>
+inline void IRAM_ATTR OutputPin<Pin>::Low()
+{
+    GPOC = (1 << Pin);
+}
+
+//GPIO16 sits in the RTC block and has its own register
+template <>
+inline void IRAM_ATTR OutputPin<16>::High()
+{
+    GP16O |= 1;
+}
+
+template <>
+inline void IRAM_ATTR OutputPin<16>::Low()
+{
+    GP16O &= ~1;
+}
+
+#else
+
+struct MockGpio
+{
+    static inline uint8_t levels[17] = {};
+    static inline uint8_t modes[17] = {};
+};
+
+template <uint8_t Pin>
+void OutputPin<Pin>::Begin()
+{
+    MockGpio::modes[Pin] = OUTPUT;
+}
+
+template <uint8_t Pin>
+inline void OutputPin<Pin>::High()
+{
+    MockGpio::levels[Pin] = HIGH;
+}
+
+template <uint8_t Pin>
+inline void OutputPin<Pin>::Low()
+{
+    MockGpio::levels[Pin] = LOW;
+}
+
+#endif
+
+//Runtime handle to an OutputPin, for tables indexed at runtime such as the zone pumps
+struct DigitalOutput
+{
+    void (*begin)();
+    void (*high)();
+    void (*low)();
+};
+
+template <uint8_t Pin>
+constexpr DigitalOutput MakeDigitalOutput()
+{
+    return { &OutputPin<Pin>::Begin, &OutputPin<Pin>::High, &OutputPin<Pin>::Low };
+}
+
+#endif
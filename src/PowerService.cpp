@@ -0,0 +1,100 @@
+#include "PowerService.h"
+#include "Arduino.h"
+#include <ESP8266WiFi.h>
+
+void PowerService::SetPowerSaveMode(PowerSaveMode mode, byte listenInterval)
+{
+    switch(mode)
+    {
+        case PowerSaveNone:
+            WiFi.setSleepMode(WIFI_NONE_SLEEP);
+            break;
+
+        case PowerSaveModem:
+            WiFi.setSleepMode(WIFI_MODEM_SLEEP);
+            break;
+
+        case PowerSaveLight:
+            //The radio only wakes for every listenInterval-th DTIM beacon, HTTP stays reachable with that much extra latency
+            WiFi.setSleepMode(WIFI_LIGHT_SLEEP, listenInterval);
+            break;
+    }
+
+    _mode = mode;
+    _startMillis = millis();
+    _idleMicros = 0;
+    _idleCount = 0;
+    _totalWakeLatencyMicros = 0;
+    _maxWakeLatencyMicros = 0;
+}
+
+PowerSaveMode PowerService::GetPowerSaveMode()
+{
+    return _mode;
+}
+
+//delay() is where the SDK enters automatic sleep, the overshoot past idleMillis is the wake latency
+void PowerService::Idle(unsigned long idleMillis)
+{
+    if(idleMillis == 0)
+    {
+        return;
+    }
+
+    unsigned long startMicros = micros();
+    delay(idleMillis);
+    unsigned long sleptMicros = micros() - startMicros;
+
+    unsigned long wakeLatencyMicros = sleptMicros > idleMillis * 1000 ? sleptMicros - idleMillis * 1000 : 0;
+
+    _idleMicros += sleptMicros;
+    _idleCount++;
+    _totalWakeLatencyMicros += wakeLatencyMicros;
+
+    if(wakeLatencyMicros > _maxWakeLatencyMicros)
+    {
+        _maxWakeLatencyMicros = wakeLatencyMicros;
+    }
+}
+
+double PowerService::GetIdleFraction()
+{
+    unsigned long elapsedMillis = millis() - _startMillis;
+
+    if(elapsedMillis == 0)
+    {
+        return 0;
+    }
+
+    double idleFraction = _idleMicros / 1000.0 / elapsedMillis;
+
+    return idleFraction > 1 ? 1 : idleFraction;
+}
+
+double PowerService::GetEstimatedCurrentMilliamps()
+{
+    double idleCurrent = noSleepIdleCurrentMilliamps;
+
+    if(_mode == PowerSaveModem)
+    {
+        idleCurrent = modemSleepIdleCurrentMilliamps;
+    }
+    else if(_mode == PowerSaveLight)
+    {
+        idleCurrent = lightSleepIdleCurrentMilliamps;
+    }
+
+    double idleFraction = GetIdleFraction();
+
+    return idleFraction * idleCurrent + (1 - idleFraction) * activeCurrentMilliamps;
+}
+
+unsigned long PowerService::GetMaxWakeLatencyMicros()
+{
+    return _maxWakeLatencyMicros;
+}
+
+unsigned long PowerService::GetAverageWakeLatencyMicros()
+{
+    return _idleCount == 0 ? 0 : _totalWakeLatencyMicros / _idleCount;
+}
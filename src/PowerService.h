@@ -0,0 +1,40 @@
+#ifndef PowerService_h
+#define PowerService_h
+#include "Arduino.h"
+
+//Rough ESP8266 datasheet figures, used to estimate the average draw from time spent idle vs active
+#define activeCurrentMilliamps 80.0
+#define modemSleepIdleCurrentMilliamps 15.0
+#define lightSleepIdleCurrentMilliamps 3.0 //including the DTIM beacon wake ups
+#define noSleepIdleCurrentMilliamps 70.0
+
+enum PowerSaveMode
+{
+    PowerSaveNone,
+    PowerSaveModem,
+    PowerSaveLight
+};
+
+//Idles the CPU in delay() between control ticks so the SDK can put the modem (and with light sleep the CPU) to sleep
+class PowerService
+{
+    public:
+        void SetPowerSaveMode(PowerSaveMode mode, byte listenInterval);
+        PowerSaveMode GetPowerSaveMode();
+        void Idle(unsigned long idleMillis);
+
+        double GetIdleFraction();
+        double GetEstimatedCurrentMilliamps();
+        unsigned long GetMaxWakeLatencyMicros();
+        unsigned long GetAverageWakeLatencyMicros();
+
+    private:
+        PowerSaveMode _mode = PowerSaveModem;
+        unsigned long _startMillis = 0;
+        unsigned long long _idleMicros = 0;
+        unsigned long _idleCount = 0;
+        unsigned long long _totalWakeLatencyMicros = 0;
+        unsigned long _maxWakeLatencyMicros = 0;
+};
+
+#endif
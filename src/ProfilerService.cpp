@@ -0,0 +1,142 @@
+#include "ProfilerService.h"
+#include "Arduino.h"
+#include <ArduinoJson.h>
+
+byte ProfilerService::RegisterSection(const __FlashStringHelper* name)
+{
+    //Sharing a slot would merge and mislabel sections, so extra ones are left out and counted in the output
+    if(_numberOfSections >= profilerMaxSections)
+    {
+        _rejectedSections++;
+        return profilerNoSection;
+    }
+
+    Section& section = _sections[_numberOfSections];
+    memset(&section, 0, sizeof(Section));
+    section.name = name;
+
+    return _numberOfSections++;
+}
+
+void ProfilerService::Record(byte section, unsigned long durationMicros)
+{
+    if(section == profilerNoSection)
+    {
+        return;
+    }
+
+    Section& target = _sections[section];
+
+    target.count++;
+    target.totalMicros += durationMicros;
+
+    if(durationMicros > target.maxMicros)
+    {
+        target.maxMicros = durationMicros;
+    }
+
+    target.buckets[GetBucket(durationMicros)]++;
+}
+
+byte ProfilerService::GetBucket(unsigned long durationMicros)
+{
+    //Index of the highest set bit + 1, so 0us -> 0, 1us -> 1, 2-3us -> 2, 4-7us -> 3 ...
+    byte bucket = durationMicros == 0 ? 0 : 32 - __builtin_clzl(durationMicros);
+
+    return bucket < profilerBuckets ? bucket : profilerBuckets - 1;
+}
+
+byte ProfilerService::GetUsedBuckets(Section& section)
+{
+    byte usedBuckets = 0;
+
+    for(byte b = 0; b < profilerBuckets; b++)
+    {
+        if(section.buckets[b] != 0)
+        {
+            usedBuckets = b + 1;
+        }
+    }
+
+    return usedBuckets;
+}
+
+String ProfilerService::ToJson()
+{
+    //Sized for what is actually there, names come from flash and are copied into the document
+    size_t capacity = JSON_OBJECT_SIZE(_numberOfSections + 1);
+
+    for(byte i = 0; i < _numberOfSections; i++)
+    {
+        capacity += JSON_OBJECT_SIZE(4) + JSON_ARRAY_SIZE(GetUsedBuckets(_sections[i])) + strlen_P((PGM_P)_sections[i].name) + 1;
+    }
+
+    DynamicJsonDocument doc(capacity);
+
+    for(byte i = 0; i < _numberOfSections; i++)
+    {
+        Section& section = _sections[i];
+        JsonObject entry = doc.createNestedObject(section.name);
+
+        entry["Count"] = section.count;
+        entry["AverageMicros"] = section.count == 0 ? 0 : section.totalMicros / section.count;
+        entry["MaxMicros"] = section.maxMicros;
+
+        //Buckets are trimmed after the last non-empty one to keep the response small
+        byte usedBuckets = GetUsedBuckets(section);
+
+        JsonArray buckets = entry.createNestedArray("BucketsLog2Micros");
+        for(byte b = 0; b < usedBuckets; b++)
+        {
+            buckets.add(section.buckets[b]);
+        }
+    }
+
+    //Sections that did not fit the table, raise profilerMaxSections when this is not 0
+    doc["UnprofiledSections"] = _rejectedSections;
+
+    return doc.as<String>();
+}
+
+byte ProfilerService::GetNumberOfSections()
+{
+    return _numberOfSections;
+}
+
+void ProfilerService::PrintHeaderTo(Print& output)
+{
+    output.println(F("section: count avg/max us | log2 buckets"));
+}
+
+//One line per call, so a dump can be spread over several loop() passes
+void ProfilerService::PrintSectionTo(Print& output, byte section)
+{
+    Section& target = _sections[section];
+
+    output.print(target.name);
+    output.print(F(": "));
+    output.print(target.count);
+    output.print(' ');
+    output.print(target.count == 0 ? 0 : target.totalMicros / target.count);
+    output.print('/');
+    output.print(target.maxMicros);
+    output.print(F(" |"));
+
+    for(byte b = 0; b < profilerBuckets; b++)
+    {
+        output.print(' ');
+        output.print(target.buckets[b]);
+    }
+
+    output.println();
+}
+
+void ProfilerService::Reset()
+{
+    for(byte i = 0; i < _numberOfSections; i++)
+    {
+        const __FlashStringHelper* name = _sections[i].name;
+        memset(&_sections[i], 0, sizeof(Section));
+        _sections[i].name = name;
+    }
+}
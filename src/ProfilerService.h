@@ -0,0 +1,61 @@
+#ifndef ProfilerService_h
+#define ProfilerService_h
+#include "Arduino.h"
+
+#define profilerMaxSections 40 //loop sections + one per route (26 in restServerRouting), with room to grow
+#define profilerNoSection 0xFF //returned when the table is full, recording to it does nothing
+#define profilerBuckets 24 //bucket i counts durations below 2^i microseconds, last bucket is open ended
+
+class ProfilerService
+{
+    public:
+        byte RegisterSection(const __FlashStringHelper* name);
+        void Record(byte section, unsigned long durationMicros);
+        String ToJson();
+        byte GetNumberOfSections();
+        void PrintHeaderTo(Print& output);
+        void PrintSectionTo(Print& output, byte section);
+        void Reset();
+
+    private:
+        struct Section
+        {
+            const __FlashStringHelper* name;
+            unsigned long count;
+            unsigned long totalMicros;
+            unsigned long maxMicros;
+            unsigned long buckets[profilerBuckets];
+        };
+
+        Section _sections[profilerMaxSections];
+        byte _numberOfSections = 0;
+        byte _rejectedSections = 0;
+
+        byte GetBucket(unsigned long durationMicros);
+        byte GetUsedBuckets(Section& section);
+};
+
+//Measures the lifetime of the enclosing scope and records it in the given section
+class ProfilerScope
+{
+    public:
+        ProfilerScope(ProfilerService& profilerService, byte section) : _profilerService(profilerService), _section(section), _startMicros(micros()) {}
+        ~ProfilerScope() { _profilerService.Record(_section, micros() - _startMicros); }
+
+    private:
+        ProfilerService& _profilerService;
+        byte _section;
+        unsigned long _startMicros;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+//Compiled away entirely unless ENABLE_PROFILING is set in platformio.ini
+#ifdef ENABLE_PROFILING
+#define PROFILE_SCOPE(profilerService, section) ProfilerScope PROFILE_CONCAT(_profilerScope, __LINE__)(profilerService, section)
+#else
+#define PROFILE_SCOPE(profilerService, section)
+#endif
+
+#endif
@@ -0,0 +1,59 @@
+#include "PumpDoseService.h"
+#include "Coroutine.h"
+
+void PumpDoseService::Start(unsigned long targetPulses, unsigned long maxMillis)
+{
+    _targetPulses = targetPulses;
+    _maxMillis = maxMillis;
+    _timedOut = false;
+
+    _flowMeterService.ResetPulses();
+    _startMillis = Coroutine::clock();
+}
+
+bool PumpDoseService::IsDone()
+{
+    bool timeUp = Coroutine::clock() - _startMillis >= _maxMillis;
+
+    if(!IsByVolume())
+    {
+        return timeUp;
+    }
+
+    if(_flowMeterService.GetPulses() >= _targetPulses)
+    {
+        return true;
+    }
+
+    _timedOut = timeUp;
+
+    return timeUp;
+}
+
+void PumpDoseService::Stop()
+{
+    _pumpMillis = Coroutine::clock() - _startMillis;
+}
+
+bool PumpDoseService::IsByVolume()
+{
+    return _targetPulses > 0;
+}
+
+//Only by volume, the target volume was not reached before maxMillis
+bool PumpDoseService::HasTimedOut()
+{
+    return _timedOut;
+}
+
+//Run time of the last pump run, from Start() to Stop()
+unsigned long PumpDoseService::GetPumpMillis()
+{
+    return _pumpMillis;
+}
+
+//Keeps counting after Stop(), read it after the hose has drained
+double PumpDoseService::GetMillilitres(double pulsesPerLitre)
+{
+    return _flowMeterService.GetMillilitres(pulsesPerLitre);
+}
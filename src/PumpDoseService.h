@@ -0,0 +1,28 @@
+#ifndef PumpDoseService_h
+#define PumpDoseService_h
+#include "FlowMeterService.h"
+
+//Meters one pump run: by volume until the flow meter reaches the target pulses, by time otherwise, never past
+//maxMillis. Switching the pump is left to the caller. Time is read through Coroutine::clock, so the host tests
+//drive it with a simulated clock and simulated flow meter pulses.
+class PumpDoseService
+{
+    public:
+        void Start(unsigned long targetPulses, unsigned long maxMillis); //targetPulses 0 doses by time
+        bool IsDone();
+        void Stop();
+        bool IsByVolume();
+        bool HasTimedOut();
+        unsigned long GetPumpMillis();
+        double GetMillilitres(double pulsesPerLitre);
+
+    private:
+        FlowMeterService _flowMeterService;
+        unsigned long _targetPulses = 0;
+        unsigned long _maxMillis = 0; //stop time by time, timeout by volume
+        unsigned long _startMillis = 0;
+        unsigned long _pumpMillis = 0;
+        bool _timedOut = false;
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include "RateLimiterService.h"
+#include "Arduino.h"
+
+void RateLimiterService::Begin(const RateLimiterSettings& settings)
+{
+    _settings = settings;
+    _global.tokens = settings.globalCapacity;
+    _global.lastRefillMillis = millis();
+    _numberOfClients = 0;
+}
+
+//Takes cost tokens from both buckets, or none when either is short. retryAfterSeconds is set on rejection.
+bool RateLimiterService::Admit(uint32_t clientIp, unsigned long cost, unsigned long& retryAfterSeconds)
+{
+    unsigned long now = millis();
+
+    Refill(_global, _settings.globalCapacity, _settings.globalRefillPerSecond, now);
+    Client& client = FindClient(clientIp, now);
+
+    //A cost above a capacity would never be admitted, such a request waits for a full bucket instead
+    double clientCost = min((double)cost, _settings.clientCapacity);
+    double globalCost = min((double)cost, _settings.globalCapacity);
+
+    if(client.bucket.tokens < clientCost)
+    {
+        _rejectedByClientLimit++;
+        retryAfterSeconds = GetRetryAfterSeconds(client.bucket, clientCost, _settings.clientRefillPerSecond);
+        return false;
+    }
+
+    if(_global.tokens < globalCost)
+    {
+        _rejectedByGlobalLimit++;
+        retryAfterSeconds = GetRetryAfterSeconds(_global, globalCost, _settings.globalRefillPerSecond);
+        return false;
+    }
+
+    client.bucket.tokens -= clientCost;
+    _global.tokens -= globalCost;
+    _admitted++;
+
+    return true;
+}
+
+RateLimiterService::Client& RateLimiterService::FindClient(uint32_t clientIp, unsigned long now)
+{
+    byte oldest = 0;
+
+    for(byte i = 0; i < _numberOfClients; i++)
+    {
+        if(_clients[i].ip == clientIp)
+        {
+            Refill(_clients[i].bucket, _settings.clientCapacity, _settings.clientRefillPerSecond, now);
+            return _clients[i];
+        }
+
+        if(now - _clients[i].bucket.lastRefillMillis > now - _clients[oldest].bucket.lastRefillMillis)
+        {
+            oldest = i;
+        }
+    }
+
+    byte slot = _numberOfClients < rateLimiterMaxClients ? _numberOfClients++ : oldest;
+
+    _clients[slot].ip = clientIp;
+    _clients[slot].bucket.tokens = _settings.clientCapacity;
+    _clients[slot].bucket.lastRefillMillis = now;
+
+    return _clients[slot];
+}
+
+void RateLimiterService::Refill(TokenBucket& bucket, double capacity, double refillPerSecond, unsigned long now)
+{
+    bucket.tokens = min(capacity, bucket.tokens + (now - bucket.lastRefillMillis) * refillPerSecond / 1000);
+    bucket.lastRefillMillis = now;
+}
+
+unsigned long RateLimiterService::GetRetryAfterSeconds(const TokenBucket& bucket, double cost, double refillPerSecond)
+{
+    return (unsigned long)ceil((cost - bucket.tokens) / refillPerSecond);
+}
+
+unsigned long RateLimiterService::GetAdmitted()
+{
+    return _admitted;
+}
+
+unsigned long RateLimiterService::GetRejectedByClientLimit()
+{
+    return _rejectedByClientLimit;
+}
+
+unsigned long RateLimiterService::GetRejectedByGlobalLimit()
+{
+    return _rejectedByGlobalLimit;
+}
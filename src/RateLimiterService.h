@@ -0,0 +1,54 @@
+#ifndef RateLimiterService_h
+#define RateLimiterService_h
+#include "Arduino.h"
+
+#define rateLimiterMaxClients 8 //least recently seen client is forgotten when a new one arrives
+
+//Tokens are milliseconds of loop time a request is expected to block. The global bucket refills at
+//maxShare * 1000 per second, so requests together never take more than that share of the loop.
+struct TokenBucket
+{
+    double tokens;
+    unsigned long lastRefillMillis;
+};
+
+struct RateLimiterSettings
+{
+    double globalCapacity;
+    double globalRefillPerSecond;
+    double clientCapacity;
+    double clientRefillPerSecond;
+};
+
+//Per-client and global token buckets for the HTTP API
+class RateLimiterService
+{
+    public:
+        void Begin(const RateLimiterSettings& settings);
+        bool Admit(uint32_t clientIp, unsigned long cost, unsigned long& retryAfterSeconds);
+
+        unsigned long GetAdmitted();
+        unsigned long GetRejectedByClientLimit();
+        unsigned long GetRejectedByGlobalLimit();
+
+    private:
+        struct Client
+        {
+            uint32_t ip;
+            TokenBucket bucket;
+        };
+
+        RateLimiterSettings _settings;
+        TokenBucket _global;
+        Client _clients[rateLimiterMaxClients];
+        byte _numberOfClients = 0;
+        unsigned long _admitted = 0;
+        unsigned long _rejectedByClientLimit = 0;
+        unsigned long _rejectedByGlobalLimit = 0;
+
+        Client& FindClient(uint32_t clientIp, unsigned long now);
+        void Refill(TokenBucket& bucket, double capacity, double refillPerSecond, unsigned long now);
+        unsigned long GetRetryAfterSeconds(const TokenBucket& bucket, double cost, double refillPerSecond);
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include "RtcStateService.h"
+#include "Arduino.h"
+#include <stddef.h>
+
+//False on a cold boot or a corrupted block, zones are then left at their defaults
+bool RtcStateService::Restore(Zone zones[], unsigned long& clockMillis, unsigned long& lastAwakeMillis, unsigned long& wakeCount)
+{
+    RtcState state;
+
+    if(!ESP.rtcUserMemoryRead(0, (uint32_t*)&state, sizeof(state)))
+    {
+        return false;
+    }
+
+    if(state.magic != rtcStateMagic || state.crc != Crc32(state))
+    {
+        return false;
+    }
+
+    for(byte zone = 0; zone < numberOfZones; zone++)
+    {
+        const RtcZoneState& saved = state.zones[zone];
+        Zone& z = zones[zone];
+
+        z.lastSoilReadingMillis = saved.lastSoilReadingMillis;
+        z.lastWateringMillis = saved.lastWateringMillis;
+        z.predictedSoilReadingIntervalMillis = saved.predictedSoilReadingIntervalMillis;
+        z.averageSoilReading = saved.averageSoilReading;
+        z.lastWateredMillilitres = saved.lastWateredMillilitres;
+        z.notified = saved.notified;
+        z.unchangedSoilReadings = saved.unchangedSoilReadings;
+        z.wateringResponse = saved.wateringResponse;
+        z.dryingRate = saved.dryingRate;
+        z.controller = saved.controller;
+    }
+
+    clockMillis = state.clockMillis;
+    lastAwakeMillis = state.lastAwakeMillis;
+    wakeCount = state.wakeCount;
+
+    return true;
+}
+
+void RtcStateService::Save(const Zone zones[], unsigned long clockMillis, unsigned long lastAwakeMillis, unsigned long wakeCount)
+{
+    RtcState state;
+    memset((void*)&state, 0, sizeof(state)); //padding is part of the checksum
+
+    for(byte zone = 0; zone < numberOfZones; zone++)
+    {
+        RtcZoneState& saved = state.zones[zone];
+        const Zone& z = zones[zone];
+
+        saved.lastSoilReadingMillis = z.lastSoilReadingMillis;
+        saved.lastWateringMillis = z.lastWateringMillis;
+        saved.predictedSoilReadingIntervalMillis = z.predictedSoilReadingIntervalMillis;
+        saved.averageSoilReading = z.averageSoilReading;
+        saved.lastWateredMillilitres = z.lastWateredMillilitres;
+        saved.notified = z.notified;
+        saved.unchangedSoilReadings = z.unchangedSoilReadings;
+        saved.wateringResponse = z.wateringResponse;
+        saved.dryingRate = z.dryingRate;
+        saved.controller = z.controller;
+    }
+
+    state.magic = rtcStateMagic;
+    state.clockMillis = clockMillis;
+    state.lastAwakeMillis = lastAwakeMillis;
+    state.wakeCount = wakeCount;
+    state.crc = Crc32(state);
+
+    ESP.rtcUserMemoryWrite(0, (uint32_t*)&state, sizeof(state));
+}
+
+//CRC-32 of everything after the crc field
+uint32_t RtcStateService::Crc32(const RtcState& state)
+{
+    const uint8_t* data = (const uint8_t*)&state + offsetof(RtcState, crc) + sizeof(state.crc);
+    size_t length = sizeof(state) - offsetof(RtcState, crc) - sizeof(state.crc);
+    uint32_t crc = 0xFFFFFFFF;
+
+    for(size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+
+        for(byte bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+
+    return ~crc;
+}
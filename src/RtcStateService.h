@@ -0,0 +1,48 @@
+#ifndef RtcStateService_h
+#define RtcStateService_h
+#include "Arduino.h"
+#include "Zone.h"
+
+#define rtcStateMagic 0x57415452 //"WATR", anything else in RTC memory is a cold boot
+#define rtcUserMemoryBytes 512
+
+//Control state of one zone that has to survive deep sleep, the estimators are copied as they are
+struct RtcZoneState
+{
+    unsigned long lastSoilReadingMillis;
+    unsigned long lastWateringMillis;
+    unsigned long predictedSoilReadingIntervalMillis;
+    double averageSoilReading;
+    double lastWateredMillilitres;
+    bool notified;
+    byte unchangedSoilReadings;
+    WateringResponseEstimator wateringResponse;
+    DryingRateEstimator dryingRate;
+    WateringController controller;
+};
+
+struct RtcState
+{
+    uint32_t magic;
+    uint32_t crc;
+    unsigned long clockMillis; //system clock at the moment of waking up again
+    unsigned long lastAwakeMillis; //wake to sleep time of the previous wake
+    unsigned long wakeCount;
+    RtcZoneState zones[numberOfZones];
+};
+
+static_assert(sizeof(RtcState) <= rtcUserMemoryBytes, "RTC state does not fit in RTC user memory, reduce numberOfZones or dryingRateHistorySize");
+static_assert(sizeof(RtcState) % 4 == 0, "RTC user memory is written in 4 byte blocks");
+
+//Keeps zone state in the 512 bytes of RTC user memory that survive deep sleep (but not a power cycle)
+class RtcStateService
+{
+    public:
+        bool Restore(Zone zones[], unsigned long& clockMillis, unsigned long& lastAwakeMillis, unsigned long& wakeCount);
+        void Save(const Zone zones[], unsigned long clockMillis, unsigned long lastAwakeMillis, unsigned long wakeCount);
+
+    private:
+        uint32_t Crc32(const RtcState& state);
+};
+
+#endif
@@ -0,0 +1,135 @@
+#include "SchedulerService.h"
+#include "Arduino.h"
+#include <ArduinoJson.h>
+
+byte SchedulerService::AddTask(const __FlashStringHelper* name, TaskFunction run, unsigned long periodMillis, unsigned long deadlineMillis)
+{
+    if(_numberOfTasks >= schedulerMaxTasks)
+    {
+        return schedulerNoTask;
+    }
+
+    Task& task = _tasks[_numberOfTasks];
+    memset(&task, 0, sizeof(Task));
+    task.name = name;
+    task.run = run;
+    task.periodMillis = periodMillis;
+    task.deadlineMillis = deadlineMillis;
+    task.nextRunMillis = millis();
+
+    if(_numberOfTasks == 0)
+    {
+        _startMillis = millis();
+    }
+
+    return _numberOfTasks++;
+}
+
+//Every due task runs once, in table order, so earlier tasks have priority
+void SchedulerService::RunDueTasks()
+{
+    for(byte i = 0; i < _numberOfTasks; i++)
+    {
+        Task& task = _tasks[i];
+        unsigned long now = millis();
+
+        //Signed difference keeps the comparison right across the millis() wrap
+        if((long)(now - task.nextRunMillis) < 0)
+        {
+            continue;
+        }
+
+        unsigned long latenessMillis = now - task.nextRunMillis;
+        unsigned long startMicros = micros();
+
+        task.run();
+
+        unsigned long runMicros = micros() - startMicros;
+
+        task.runs++;
+        task.totalRunMicros += runMicros;
+
+        if(runMicros > task.maxRunMicros)
+        {
+            task.maxRunMicros = runMicros;
+        }
+
+        if(latenessMillis > task.maxLatenessMillis)
+        {
+            task.maxLatenessMillis = latenessMillis;
+        }
+
+        if(latenessMillis + runMicros / 1000 > task.deadlineMillis)
+        {
+            task.overruns++;
+        }
+
+        //A late task is not run again to catch up, the next run is one period after this one started
+        task.nextRunMillis = now + task.periodMillis;
+    }
+}
+
+//Time until a periodic task is due, tasks run every tick are not counted so loop() may idle between ticks
+unsigned long SchedulerService::GetMillisUntilNextTask(unsigned long maxMillis)
+{
+    unsigned long now = millis();
+    unsigned long untilNextMillis = maxMillis;
+
+    for(byte i = 0; i < _numberOfTasks; i++)
+    {
+        Task& task = _tasks[i];
+
+        if(task.periodMillis == 0)
+        {
+            continue;
+        }
+
+        if((long)(now - task.nextRunMillis) >= 0)
+        {
+            return 0;
+        }
+
+        untilNextMillis = min(untilNextMillis, task.nextRunMillis - now);
+    }
+
+    return untilNextMillis;
+}
+
+String SchedulerService::ToJson()
+{
+    DynamicJsonDocument doc(2048);
+    unsigned long elapsedMillis = millis() - _startMillis;
+
+    for(byte i = 0; i < _numberOfTasks; i++)
+    {
+        Task& task = _tasks[i];
+        JsonObject entry = doc.createNestedObject(task.name);
+
+        entry["PeriodMillis"] = task.periodMillis;
+        entry["DeadlineMillis"] = task.deadlineMillis;
+        entry["Runs"] = task.runs;
+        entry["Overruns"] = task.overruns;
+        entry["AverageRunMicros"] = task.runs == 0 ? 0 : (unsigned long)(task.totalRunMicros / task.runs);
+        entry["MaxRunMicros"] = task.maxRunMicros;
+        entry["MaxLatenessMillis"] = task.maxLatenessMillis;
+        entry["CpuShare"] = elapsedMillis == 0 ? 0 : task.totalRunMicros / 1000.0 / elapsedMillis;
+    }
+
+    return doc.as<String>();
+}
+
+void SchedulerService::Reset()
+{
+    for(byte i = 0; i < _numberOfTasks; i++)
+    {
+        Task& task = _tasks[i];
+
+        task.runs = 0;
+        task.overruns = 0;
+        task.totalRunMicros = 0;
+        task.maxRunMicros = 0;
+        task.maxLatenessMillis = 0;
+    }
+
+    _startMillis = millis();
+}
@@ -0,0 +1,42 @@
+#ifndef SchedulerService_h
+#define SchedulerService_h
+#include "Arduino.h"
+
+#define schedulerMaxTasks 8
+#define schedulerNoTask 0xFF //returned when the table is full, the task never runs
+
+typedef void (*TaskFunction)();
+
+//Runs a fixed table of tasks from loop(). A task is due every periodMillis (0 runs it every tick) and has to
+//finish within deadlineMillis of becoming due, otherwise the run is counted as an overrun. Tasks never preempt
+//each other, so a task that blocks delays every task behind it.
+class SchedulerService
+{
+    public:
+        byte AddTask(const __FlashStringHelper* name, TaskFunction run, unsigned long periodMillis, unsigned long deadlineMillis);
+        void RunDueTasks();
+        unsigned long GetMillisUntilNextTask(unsigned long maxMillis);
+        String ToJson();
+        void Reset();
+
+    private:
+        struct Task
+        {
+            const __FlashStringHelper* name;
+            TaskFunction run;
+            unsigned long periodMillis;
+            unsigned long deadlineMillis;
+            unsigned long nextRunMillis;
+            unsigned long runs;
+            unsigned long overruns;
+            unsigned long long totalRunMicros;
+            unsigned long maxRunMicros;
+            unsigned long maxLatenessMillis;
+        };
+
+        Task _tasks[schedulerMaxTasks];
+        byte _numberOfTasks = 0;
+        unsigned long _startMillis = 0;
+};
+
+#endif
@@ -0,0 +1,117 @@
+#include "SoilMeasurementService.h"
+#include "Coroutine.h"
+#include "Arduino.h"
+
+void SoilMeasurementService::Start(const SoilMeasurementSettings& settings)
+{
+    _settings = settings;
+    _filter.Reset();
+
+    _soilSensorService.ActivateSoilSensor(_settings.sensorPower);
+    _powerOnMillis = Coroutine::clock();
+    _state = Settling;
+}
+
+bool SoilMeasurementService::Update()
+{
+    if(_state == Settling && Coroutine::clock() - _powerOnMillis >= _settings.settleMillis)
+    {
+        _samplingStartMicros = micros();
+        _state = Sampling;
+    }
+
+    if(_state == Sampling)
+    {
+        Sample();
+
+        if(_filter.IsComplete(_settings.minSamples, _settings.maxSamples, _settings.tolerance))
+        {
+            Finish();
+        }
+    }
+
+    return _state == Done;
+}
+
+void SoilMeasurementService::Sample()
+{
+    static uint16_t buffer[soilMeasurementChunkSize];
+
+    //The last chunk only takes what is left, maxSamples is a hard limit on sensor on time
+    uint16_t count = min((unsigned long)soilMeasurementChunkSize, (unsigned long)_settings.maxSamples - _filter.GetCount());
+
+    _soilSensorService.GetSensorReadings(_settings.readGpio, buffer, count);
+
+    for(uint16_t i = 0; i < count; i++)
+    {
+        _filter.Add(buffer[i]);
+    }
+}
+
+void SoilMeasurementService::Finish()
+{
+    //Power off the moment the last sample is in, the filter math does not need the sensor
+    _soilSensorService.DisableSoilSensor(_settings.sensorPower);
+
+    _samplingMicros = micros() - _samplingStartMicros;
+    _sensorOnMillis = Coroutine::clock() - _powerOnMillis;
+    _totalSensorOnMillis += _sensorOnMillis;
+    _state = Done;
+}
+
+bool SoilMeasurementService::IsRunning()
+{
+    return _state == Settling || _state == Sampling;
+}
+
+//Blocks until the started measurement is done, yields so Wi-Fi keeps running during the settle time
+double SoilMeasurementService::WaitForReading()
+{
+    while(IsRunning())
+    {
+        Update();
+        yield();
+    }
+
+    return GetReading();
+}
+
+double SoilMeasurementService::GetReading()
+{
+    return _filter.GetEstimate();
+}
+
+double SoilMeasurementService::GetVariance()
+{
+    return _filter.GetVariance();
+}
+
+double SoilMeasurementService::GetRobustVariance()
+{
+    return _filter.GetRobustVariance();
+}
+
+double SoilMeasurementService::GetError()
+{
+    return _filter.GetError();
+}
+
+unsigned long SoilMeasurementService::GetSamples()
+{
+    return _filter.GetCount();
+}
+
+double SoilMeasurementService::GetSamplesPerSecond()
+{
+    return _samplingMicros == 0 ? 0 : _filter.GetCount() * 1000000.0 / _samplingMicros;
+}
+
+unsigned long SoilMeasurementService::GetSensorOnMillis()
+{
+    return _sensorOnMillis;
+}
+
+unsigned long SoilMeasurementService::GetTotalSensorOnMillis()
+{
+    return _totalSensorOnMillis;
+}
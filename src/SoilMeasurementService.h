@@ -0,0 +1,62 @@
+#ifndef SoilMeasurementService_h
+#define SoilMeasurementService_h
+#include "Arduino.h"
+#include "SoilSensorService.h"
+#include "SoilReadingFilter.h"
+
+#define soilMeasurementChunkSize 32 //samples taken per Update(), convergence is checked between chunks
+
+struct SoilMeasurementSettings
+{
+    int readGpio;
+    DigitalOutput sensorPower;
+    unsigned int settleMillis; //sensor output needs this long after power on before it is stable
+    int minSamples;
+    int maxSamples;
+    double tolerance; //sampling stops once the 95% confidence interval is within +/- this
+};
+
+//Non-blocking measurement: power on -> settle -> sample in chunks until converged -> power off.
+//Call Update() every loop() until it returns true.
+class SoilMeasurementService
+{
+    public:
+        void Start(const SoilMeasurementSettings& settings);
+        bool Update();
+        bool IsRunning();
+        double WaitForReading();
+
+        double GetReading();
+        double GetVariance();
+        double GetRobustVariance();
+        double GetError();
+        unsigned long GetSamples();
+        double GetSamplesPerSecond();
+        unsigned long GetSensorOnMillis();
+        unsigned long GetTotalSensorOnMillis();
+
+    private:
+        enum State
+        {
+            Idle,
+            Settling,
+            Sampling,
+            Done
+        };
+
+        void Sample();
+        void Finish();
+
+        SoilSensorService _soilSensorService;
+        SoilReadingFilter _filter;
+        SoilMeasurementSettings _settings;
+
+        State _state = Idle;
+        unsigned long _powerOnMillis = 0;
+        unsigned long _samplingStartMicros = 0;
+        unsigned long _samplingMicros = 0;
+        unsigned long _sensorOnMillis = 0;
+        unsigned long _totalSensorOnMillis = 0;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#include "SoilReadingFilter.h"
+#include <math.h>
+
+void SoilReadingFilter::Reset()
+{
+    for(uint8_t i = 0; i < soilReadingFilterGroups; i++)
+    {
+        _groupSums[i] = 0;
+        _groupCounts[i] = 0;
+    }
+
+    _count = 0;
+    _mean = 0;
+    _m2 = 0;
+}
+
+void SoilReadingFilter::Add(double sample)
+{
+    //Round robin so a burst of noise is spread over the groups instead of poisoning one
+    uint8_t group = _count % soilReadingFilterGroups;
+    _groupSums[group] += sample;
+    _groupCounts[group]++;
+
+    _count++;
+    double delta = sample - _mean;
+    _mean += delta / _count;
+    _m2 += delta * (sample - _mean);
+}
+
+//Insertion sort, the array is tiny
+void SoilReadingFilter::InsertSorted(double* values, uint8_t count, double value)
+{
+    uint8_t j = count;
+
+    while(j > 0 && values[j - 1] > value)
+    {
+        values[j] = values[j - 1];
+        j--;
+    }
+
+    values[j] = value;
+}
+
+double SoilReadingFilter::GetMedian(const double* sortedValues, uint8_t count)
+{
+    if(count % 2 == 1)
+    {
+        return sortedValues[count / 2];
+    }
+
+    return (sortedValues[count / 2 - 1] + sortedValues[count / 2]) / 2;
+}
+
+uint8_t SoilReadingFilter::GetSortedGroupMeans(double* groupMeans)
+{
+    uint8_t numberOfGroups = 0;
+
+    for(uint8_t i = 0; i < soilReadingFilterGroups; i++)
+    {
+        if(_groupCounts[i] == 0)
+        {
+            continue;
+        }
+
+        InsertSorted(groupMeans, numberOfGroups, _groupSums[i] / _groupCounts[i]);
+        numberOfGroups++;
+    }
+
+    return numberOfGroups;
+}
+
+double SoilReadingFilter::GetEstimate()
+{
+    double groupMeans[soilReadingFilterGroups];
+    uint8_t numberOfGroups = GetSortedGroupMeans(groupMeans);
+
+    if(numberOfGroups == 0)
+    {
+        return 0;
+    }
+
+    return GetMedian(groupMeans, numberOfGroups);
+}
+
+double SoilReadingFilter::GetMean()
+{
+    return _mean;
+}
+
+double SoilReadingFilter::GetVariance()
+{
+    return _count < 2 ? 0 : _m2 / (_count - 1);
+}
+
+//Sample variance as seen through the spread of the group means. A spike moves one group mean, which the median
+//absolute deviation ignores, while a floating input spreads all of them. Group means vary by variance / group size.
+double SoilReadingFilter::GetRobustVariance()
+{
+    double groupMeans[soilReadingFilterGroups];
+    uint8_t numberOfGroups = GetSortedGroupMeans(groupMeans);
+
+    if(numberOfGroups < 3)
+    {
+        return GetVariance();
+    }
+
+    double median = GetMedian(groupMeans, numberOfGroups);
+    double deviations[soilReadingFilterGroups];
+
+    for(uint8_t i = 0; i < numberOfGroups; i++)
+    {
+        InsertSorted(deviations, i, fabs(groupMeans[i] - median));
+    }
+
+    double groupMeanDeviation = madToStandardDeviation * GetMedian(deviations, numberOfGroups);
+
+    return groupMeanDeviation * groupMeanDeviation * _count / numberOfGroups;
+}
+
+unsigned long SoilReadingFilter::GetCount()
+{
+    return _count;
+}
+
+//Half width of the confidence interval of the median-of-means estimate. Taken from the robust variance, so one ADC
+//spike does not keep the sensor sampling up to the limit
+double SoilReadingFilter::GetError()
+{
+    if(_count < 2)
+    {
+        return INFINITY;
+    }
+
+    return soilReadingConfidenceFactor * sqrt(medianOfMeansVarianceFactor * GetRobustVariance() / _count);
+}
+
+bool SoilReadingFilter::HasConverged(double tolerance)
+{
+    return GetError() <= tolerance;
+}
+
+//Sampling stops once the estimate has converged, but never before minSamples and never after maxSamples
+bool SoilReadingFilter::IsComplete(unsigned long minSamples, unsigned long maxSamples, double tolerance)
+{
+    if(_count >= maxSamples)
+    {
+        return true;
+    }
+
+    return _count >= minSamples && HasConverged(tolerance);
+}
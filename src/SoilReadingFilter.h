@@ -0,0 +1,38 @@
+#ifndef SoilReadingFilter_h
+#define SoilReadingFilter_h
+#include <stdint.h>
+
+#define soilReadingFilterGroups 9 //Spikes must hit more than half the groups to move the estimate
+#define soilReadingConfidenceFactor 3.2 //95% interval, wider than the normal 1.96 as the spread is only known from 9 group means
+#define madToStandardDeviation 1.4826 //median absolute deviation of normal noise times this is its standard deviation
+#define medianOfMeansVarianceFactor 1.5 //the median of 9 normal group means varies about 1.5 times as much as their mean
+
+//Streaming median-of-means estimator with Welford mean/variance, fixed memory regardless of sample count.
+//The estimate, its error and the robust variance only look at the group means, a spike moves just one of them.
+class SoilReadingFilter
+{
+    public:
+        void Reset();
+        void Add(double sample);
+        double GetEstimate();
+        double GetMean();
+        double GetVariance();
+        double GetRobustVariance();
+        unsigned long GetCount();
+        double GetError();
+        bool HasConverged(double tolerance);
+        bool IsComplete(unsigned long minSamples, unsigned long maxSamples, double tolerance);
+
+    private:
+        double _groupSums[soilReadingFilterGroups];
+        unsigned int _groupCounts[soilReadingFilterGroups];
+        unsigned long _count = 0;
+        double _mean = 0;
+        double _m2 = 0;
+
+        uint8_t GetSortedGroupMeans(double* groupMeans);
+        static void InsertSorted(double* values, uint8_t count, double value);
+        static double GetMedian(const double* sortedValues, uint8_t count);
+};
+
+#endif
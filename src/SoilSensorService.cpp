@@ -1,17 +1,39 @@
 #include "SoilSensorService.h"
 #include "Arduino.h"
 
+extern "C" {
+#include "user_interface.h"
+}
+
 double SoilSensorService::GetSensorReading(int gpio)
 {
     return analogRead(gpio);
 }
 
-void SoilSensorService::ActivateSoilSensor(int gpio)
+//The SDK burst read is only allowed while the radio is switched off, i.e. on a deep sleep wake before Wi-Fi starts.
+//With the radio on the samples are taken one analogRead() at a time as before.
+void SoilSensorService::GetSensorReadings(int gpio, uint16_t* buffer, uint16_t count)
+{
+    if(wifi_get_opmode() == NULL_MODE)
+    {
+        ets_intr_lock();
+        system_adc_read_fast(buffer, count, soilSensorAdcClockDivider);
+        ets_intr_unlock();
+        return;
+    }
+
+    for(uint16_t i = 0; i < count; i++)
+    {
+        buffer[i] = analogRead(gpio);
+    }
+}
+
+void SoilSensorService::ActivateSoilSensor(const DigitalOutput& sensorPower)
 {
-    digitalWrite(gpio, HIGH);
+    sensorPower.high();
 }
 
-void SoilSensorService::DisableSoilSensor(int gpio)
+void SoilSensorService::DisableSoilSensor(const DigitalOutput& sensorPower)
 {
-    digitalWrite(gpio, LOW);
+    sensorPower.low();
 }
\ No newline at end of file
@@ -1,13 +1,17 @@
 #ifndef SoilSensorService_h
 #define SoilSesnsorService_h
 #include "Arduino.h"
+#include "OutputPin.h"
+
+#define soilSensorAdcClockDivider 8 //SDK recommended divider for system_adc_read_fast
 
 class SoilSensorService
 {
     public:
         double GetSensorReading(int gpio);
-        void ActivateSoilSensor(int gpio);
-        void DisableSoilSensor(int gpio);
+        void GetSensorReadings(int gpio, uint16_t* buffer, uint16_t count);
+        void ActivateSoilSensor(const DigitalOutput& sensorPower);
+        void DisableSoilSensor(const DigitalOutput& sensorPower);
 };
 
 #endif
\ No newline at end of file
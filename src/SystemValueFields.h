@@ -0,0 +1,92 @@
+#ifndef SystemValueFields_h
+#define SystemValueFields_h
+#include <stddef.h>
+#include <ArduinoJson.h>
+
+//How each value of /get-watering-system-values is stored in the document, for the capacity
+enum SystemValueKind
+{
+    IntegerValue,
+    RealValue,
+    BoolValue,
+    TextValue, //a string literal, the document only keeps the pointer
+    DurationValue //a String copied into the document with long keys, a number with short keys
+};
+
+#define systemValueMaxStringLength 15 //String(double) of a duration, millis() minutes are at most "71582.00"
+
+//One row per value: long key, short key, kind, and the expression main.cpp reads it with into v for zone.
+//The host test expands the same rows without the read expression, so it covers the table main.cpp serves.
+#define SYSTEM_VALUE_FIELDS(FIELD) \
+    FIELD("Zone", "z", IntegerValue, v.set(zone)) \
+    FIELD("NumberOfZones", "nz", IntegerValue, v.set(numberOfZones)) \
+    FIELD("DrynessAllowedBeforeWatering", "da", IntegerValue, v.set(zones[zone].drynessAllowed)) \
+    FIELD("LastSoilReadingAverageValue", "r", RealValue, v.set(zones[zone].averageSoilReading)) \
+    FIELD("WateringTimeSeconds", "wt", IntegerValue, v.set(zones[zone].wateringTimeSeconds)) \
+    FIELD("MinutesBetweenSoilReadings", "mb", IntegerValue, v.set(zones[zone].soilReadingFrequencyMinutes)) \
+    FIELD("AdaptiveSoilReadingEnabled", "ae", BoolValue, v.set(adaptiveSoilReadingEnabled)) \
+    FIELD("MinutesUntilNextSoilReading", "mn", DurationValue, setSystemValueNumber(v, mathService.ConvertMillisToMinutes(zoneControlService.GetMillisUntilNextSoilReading(zone, currentTimeMillis, GetZoneControlSettings())), compact)) \
+    FIELD("MinutesAgoSinceLastSoilReading", "ma", DurationValue, setSystemValueNumber(v, mathService.ConvertMillisToMinutes(currentTimeMillis - zones[zone].lastSoilReadingMillis), compact)) \
+    FIELD("HoursAgoLastWateringCycleWasDone", "ha", DurationValue, setSystemValueNumber(v, mathService.ConvertMillisToHours(currentTimeMillis - zones[zone].lastWateringMillis), compact)) \
+    FIELD("WateringAutomationEnabled", "we", BoolValue, v.set(wateringAutomationEnabled)) \
+    FIELD("LastSoilReadingVariance", "rv", RealValue, v.set(zones[zone].soilReadingVariance)) \
+    FIELD("SoilSensorFault", "sf", BoolValue, v.set(zones[zone].soilSensorFault)) \
+    FIELD("WateringMillilitres", "wm", IntegerValue, v.set(zones[zone].wateringMillilitres)) \
+    FIELD("LastWateredMillilitres", "lw", RealValue, v.set(zones[zone].lastWateredMillilitres)) \
+    FIELD("LastWateringTimedOut", "lt", BoolValue, v.set(zones[zone].lastWateringTimedOut)) \
+    FIELD("WateringControlMode", "cm", TextValue, v.set(wateringControlMode == PidControl ? "pid" : "threshold")) \
+    FIELD("ControllerKp", "kp", RealValue, v.set(controllerGains.kp)) \
+    FIELD("ControllerKi", "ki", RealValue, v.set(controllerGains.ki)) \
+    FIELD("ControllerKd", "kd", RealValue, v.set(controllerGains.kd)) \
+    FIELD("LastDoseFraction", "df", RealValue, v.set(zones[zone].lastDoseFraction)) \
+    FIELD("PowerSaveMode", "ps", TextValue, v.set(powerSaveMode == PowerSaveLight ? "light" : (powerSaveMode == PowerSaveModem ? "modem" : "none"))) \
+    FIELD("IdleFraction", "if", RealValue, v.set(powerService.GetIdleFraction())) \
+    FIELD("EstimatedCurrentMilliamps", "ec", RealValue, v.set(powerService.GetEstimatedCurrentMilliamps())) \
+    FIELD("AverageWakeLatencyMicros", "wl", IntegerValue, v.set(powerService.GetAverageWakeLatencyMicros())) \
+    FIELD("MaxWakeLatencyMicros", "wx", IntegerValue, v.set(powerService.GetMaxWakeLatencyMicros())) \
+    FIELD("ReservoirEmpty", "re", BoolValue, v.set(zones[zone].wateringResponse.IsReservoirEmpty())) \
+    FIELD("NoEffectWateringCycles", "ne", IntegerValue, v.set(zones[zone].wateringResponse.GetNoEffectCycles())) \
+    FIELD("LastWateringResponsePerPumpSecond", "lr", RealValue, v.set(zones[zone].wateringResponse.GetLastResponsePerPumpSecond())) \
+    FIELD("UsualWateringResponsePerPumpSecond", "ur", RealValue, v.set(zones[zone].wateringResponse.GetUsualResponsePerPumpSecond())) \
+    FIELD("LastSoilReadingSamples", "rs", IntegerValue, v.set(zones[zone].soilReadingSamples)) \
+    FIELD("LastSoilReadingError", "er", RealValue, v.set(zones[zone].soilReadingError)) \
+    FIELD("SoilReadingTolerance", "st", RealValue, v.set(soilReadingTolerance)) \
+    FIELD("LastSoilReadingSamplesPerSecond", "sps", RealValue, v.set(zones[zone].soilReadingSamplesPerSecond)) \
+    FIELD("SoilSensorSettleMillis", "ss", IntegerValue, v.set(soilSensorSettleMillis)) \
+    FIELD("MqttConnected", "mc", BoolValue, v.set(mqttService.IsConnected())) \
+    FIELD("MqttPublished", "mp", IntegerValue, v.set(mqttService.GetPublished())) \
+    FIELD("MqttQueued", "mq", IntegerValue, v.set(mqttService.GetQueued())) \
+    FIELD("MqttDropped", "md", IntegerValue, v.set(mqttService.GetDropped())) \
+    FIELD("MqttConnects", "mr", IntegerValue, v.set(mqttService.GetConnects())) \
+    FIELD("UdpTelemetryEnabled", "ue", BoolValue, v.set(udpTelemetryEnabled)) \
+    FIELD("UdpTelemetrySequence", "us", IntegerValue, v.set(udpTelemetryService.GetSequence())) \
+    FIELD("UdpTelemetrySent", "ut", IntegerValue, v.set(udpTelemetryService.GetSent())) \
+    FIELD("UdpTelemetryFailed", "uf", IntegerValue, v.set(udpTelemetryService.GetFailed())) \
+    FIELD("NotificationsSent", "ns", IntegerValue, v.set(notificationService.GetSent())) \
+    FIELD("NotificationBatches", "nb", IntegerValue, v.set(notificationService.GetBatches())) \
+    FIELD("NotificationFailures", "nf", IntegerValue, v.set(notificationService.GetFailures())) \
+    FIELD("NotificationsDropped", "nd", IntegerValue, v.set(notificationService.GetDropped())) \
+    FIELD("GatewayConnections", "gc", IntegerValue, v.set(notificationService.GetConnections())) \
+    FIELD("GatewayReconnects", "gr", IntegerValue, v.set(notificationService.GetReconnects())) \
+    FIELD("HttpKeepAliveEnabled", "hk", BoolValue, v.set(httpKeepAliveEnabled)) \
+    FIELD("HttpRequests", "hr", IntegerValue, v.set(httpRequests)) \
+    FIELD("HttpConnections", "hc", IntegerValue, v.set(httpConnections)) \
+    FIELD("HttpRequestsAdmitted", "hq", IntegerValue, v.set(rateLimiterService.GetAdmitted())) \
+    FIELD("HttpRequestsRejectedByClientLimit", "hrc", IntegerValue, v.set(rateLimiterService.GetRejectedByClientLimit())) \
+    FIELD("HttpRequestsRejectedByGlobalLimit", "hrg", IntegerValue, v.set(rateLimiterService.GetRejectedByGlobalLimit())) \
+    FIELD("LastSoilSensorOnMillis", "so", IntegerValue, v.set(zones[zone].soilSensorOnMillis)) \
+    FIELD("TotalSoilSensorOnMillis", "sot", IntegerValue, v.set(soilMeasurementService.GetTotalSensorOnMillis()))
+
+#define SYSTEM_VALUE_COUNT(key, shortKey, kind, read) + 1
+#define SYSTEM_VALUE_DURATION_COUNT(key, shortKey, kind, read) + (kind == DurationValue ? 1 : 0)
+
+constexpr size_t numberOfSystemValueFields = 0 SYSTEM_VALUE_FIELDS(SYSTEM_VALUE_COUNT);
+constexpr size_t numberOfSystemValueDurations = 0 SYSTEM_VALUE_FIELDS(SYSTEM_VALUE_DURATION_COUNT);
+
+//Slots for the members plus the duration strings copied into the document
+constexpr size_t GetSystemValuesCapacity(size_t numberOfFields, size_t numberOfDurations)
+{
+    return JSON_OBJECT_SIZE(numberOfFields) + numberOfDurations * JSON_STRING_SIZE(systemValueMaxStringLength);
+}
+
+#endif
@@ -0,0 +1,61 @@
+#include "UdpTelemetryService.h"
+#include "Arduino.h"
+#include <ESP8266WiFi.h>
+
+void UdpTelemetryService::SetDestination(IPAddress address, uint16_t port)
+{
+    _address = address;
+    _port = port;
+}
+
+//Fills in the header and sequence number. A failed send still uses up its sequence number, so the receiver sees it as lost.
+bool UdpTelemetryService::Send(TelemetryDatagram& datagram)
+{
+    datagram.magic[0] = 'S';
+    datagram.magic[1] = 'W';
+    datagram.version = telemetryDatagramVersion;
+    datagram.sequence = _sequence++;
+
+    if(WiFi.status() != WL_CONNECTED || _port == 0)
+    {
+        _failed++;
+        return false;
+    }
+
+    //224.0.0.0/4 is multicast
+    bool multicast = (_address[0] & 0xF0) == 0xE0;
+    int started = multicast ? _udp.beginPacketMulticast(_address, _port, WiFi.localIP()) : _udp.beginPacket(_address, _port);
+
+    if(!started)
+    {
+        _failed++;
+        return false;
+    }
+
+    _udp.write((const uint8_t*)&datagram, sizeof(datagram));
+
+    if(!_udp.endPacket())
+    {
+        _failed++;
+        return false;
+    }
+
+    _sent++;
+
+    return true;
+}
+
+uint32_t UdpTelemetryService::GetSequence()
+{
+    return _sequence;
+}
+
+unsigned long UdpTelemetryService::GetSent()
+{
+    return _sent;
+}
+
+unsigned long UdpTelemetryService::GetFailed()
+{
+    return _failed;
+}
@@ -0,0 +1,60 @@
+#ifndef UdpTelemetryService_h
+#define UdpTelemetryService_h
+#include "Arduino.h"
+#include <WiFiUdp.h>
+
+#define telemetryDatagramVersion 1
+
+enum TelemetryEvent : uint8_t
+{
+    TelemetryMeasurement = 1,
+    TelemetryWatering = 2
+};
+
+//Flags of a telemetry datagram
+#define telemetrySensorFault 0x01
+#define telemetryReservoirEmpty 0x02
+#define telemetryWateringTimedOut 0x04
+#define telemetryAutomationEnabled 0x08
+
+//Fixed layout, little endian like the ESP8266 itself so it is sent as it is. Scaled values are integers
+//so a receiver needs no float format. Fields are only ever appended, with a new version number.
+struct __attribute__((packed)) TelemetryDatagram
+{
+    uint8_t magic[2]; //'S' 'W'
+    uint8_t version;
+    uint8_t event; //TelemetryEvent
+    uint32_t sequence; //per boot, a gap is a lost datagram, a drop to 0 a restart
+    uint32_t clockMillis;
+    uint8_t zone;
+    uint8_t flags;
+    uint16_t soilReadingTenths;
+    uint16_t soilReadingVarianceTenths;
+    uint16_t drynessAllowed;
+    uint16_t lastWateredMillilitres;
+    uint16_t lastDoseFractionThousandths;
+};
+
+static_assert(sizeof(TelemetryDatagram) == 24, "the datagram layout is part of the protocol");
+
+//Sends one datagram per measurement or watering to a unicast or multicast address
+class UdpTelemetryService
+{
+    public:
+        void SetDestination(IPAddress address, uint16_t port);
+        bool Send(TelemetryDatagram& datagram);
+
+        uint32_t GetSequence();
+        unsigned long GetSent();
+        unsigned long GetFailed();
+
+    private:
+        WiFiUDP _udp;
+        IPAddress _address;
+        uint16_t _port = 0;
+        uint32_t _sequence = 0;
+        unsigned long _sent = 0;
+        unsigned long _failed = 0;
+};
+
+#endif
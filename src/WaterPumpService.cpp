@@ -1,12 +1,11 @@
 #include "WaterPumpService.h"
-#include <Arduino.h>
 
-void WaterPumpService::StartWaterPump(int gpio)
+void WaterPumpService::StartWaterPump(const DigitalOutput& pump)
 {
-    digitalWrite(gpio, HIGH);
+    pump.high();
 }
 
-void WaterPumpService::StopWaterPump(int gpio)
+void WaterPumpService::StopWaterPump(const DigitalOutput& pump)
 {
-    digitalWrite(gpio, LOW);
+    pump.low();
 }
\ No newline at end of file
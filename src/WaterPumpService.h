@@ -1,12 +1,12 @@
 #ifndef WaterPumpService_h
 #define WaterPumpService_h
-#include <Arduino.h>
+#include "OutputPin.h"
 
 class WaterPumpService
 {
     public:
-        void StartWaterPump(int gpio);
-        void StopWaterPump(int gpio);
+        void StartWaterPump(const DigitalOutput& pump);
+        void StopWaterPump(const DigitalOutput& pump);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "WateringController.h"
+#include <math.h>
+
+double WateringController::Compute(double reading, double setpoint, unsigned long readingMillis, const WateringControllerGains& gains)
+{
+    //Higher readings are drier, so a positive error asks for water
+    double error = reading - setpoint;
+    double derivative = 0;
+    double minutes = 0;
+
+    if(_hasPrevious)
+    {
+        minutes = (readingMillis - _previousMillis) / 60000.0;
+
+        //Derivative on the measurement, not the error, so setpoint changes do not kick the pump
+        if(minutes > 0)
+        {
+            derivative = (reading - _previousReading) / minutes;
+        }
+    }
+
+    _hasPrevious = true;
+    _previousReading = reading;
+    _previousMillis = readingMillis;
+
+    double candidateIntegral = _integral + error * minutes;
+    double output = gains.kp * error + gains.ki * candidateIntegral + gains.kd * derivative;
+
+    bool saturatedHigh = output > maxDoseFraction && error > 0;
+    bool saturatedLow = output < 0 && error < 0;
+
+    if(!saturatedHigh && !saturatedLow)
+    {
+        _integral = candidateIntegral;
+    }
+
+    output = gains.kp * error + gains.ki * _integral + gains.kd * derivative;
+
+    return fmin(fmax(output, 0.0), maxDoseFraction);
+}
+
+void WateringController::Reset()
+{
+    _hasPrevious = false;
+    _integral = 0;
+}
+
+double WateringController::GetIntegral()
+{
+    return _integral;
+}
@@ -0,0 +1,30 @@
+#ifndef WateringController_h
+#define WateringController_h
+
+#define maxDoseFraction 2.0 //the controller may at most double the configured dose
+#define minDoseFraction 0.1 //smaller doses are skipped, the pump barely primes
+
+struct WateringControllerGains
+{
+    double kp; //dose per unit of reading above the setpoint
+    double ki; //dose per unit of reading above the setpoint per minute
+    double kd; //dose per unit per minute the reading rises
+};
+
+//PID on the soil reading, output is a fraction of the zone's configured dose (seconds or millilitres).
+//Anti-windup: the integral only moves while the output is not saturated in the direction of the error.
+class WateringController
+{
+    public:
+        double Compute(double reading, double setpoint, unsigned long readingMillis, const WateringControllerGains& gains);
+        void Reset();
+        double GetIntegral();
+
+    private:
+        bool _hasPrevious = false;
+        double _previousReading = 0;
+        unsigned long _previousMillis = 0;
+        double _integral = 0;
+};
+
+#endif
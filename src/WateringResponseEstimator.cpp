@@ -0,0 +1,70 @@
+#include "WateringResponseEstimator.h"
+#include <math.h>
+
+void WateringResponseEstimator::RecordWatering(double readingBefore, double pumpSeconds, bool flowDetected)
+{
+    _wateringPending = true;
+    _readingBefore = readingBefore;
+    _pumpSeconds = pumpSeconds;
+    _flowDetected = flowDetected;
+}
+
+//The first reading after a watering tells whether it had an effect
+void WateringResponseEstimator::RecordReading(double reading)
+{
+    if(!_wateringPending)
+    {
+        return;
+    }
+
+    _wateringPending = false;
+
+    //Higher readings are drier, so an effective watering lowers the reading
+    _lastResponse = _pumpSeconds > 0 ? (_readingBefore - reading) / _pumpSeconds : 0;
+
+    double noEffectThreshold = fmax(minResponsePerPumpSecond, _usualResponse * noEffectResponseFraction);
+
+    if(!_flowDetected || _lastResponse < noEffectThreshold)
+    {
+        if(_noEffectCycles < 255)
+        {
+            _noEffectCycles++;
+        }
+        return;
+    }
+
+    _noEffectCycles = 0;
+    _usualResponse = _usualResponse == 0 ? _lastResponse : _usualResponse + responseSmoothingFactor * (_lastResponse - _usualResponse);
+}
+
+//The reading after the watering could not be trusted, the watering is left unjudged
+void WateringResponseEstimator::DiscardWatering()
+{
+    _wateringPending = false;
+}
+
+//A watering is waiting for the reading that judges it
+bool WateringResponseEstimator::IsResponsePending()
+{
+    return _wateringPending;
+}
+
+bool WateringResponseEstimator::IsReservoirEmpty()
+{
+    return _noEffectCycles >= noEffectCyclesBeforeEmpty;
+}
+
+uint8_t WateringResponseEstimator::GetNoEffectCycles()
+{
+    return _noEffectCycles;
+}
+
+double WateringResponseEstimator::GetLastResponsePerPumpSecond()
+{
+    return _lastResponse;
+}
+
+double WateringResponseEstimator::GetUsualResponsePerPumpSecond()
+{
+    return _usualResponse;
+}
@@ -0,0 +1,35 @@
+#ifndef WateringResponseEstimator_h
+#define WateringResponseEstimator_h
+#include <stdint.h>
+
+#define noEffectCyclesBeforeEmpty 2 //consecutive waterings without soil response before the reservoir is considered empty
+#define minResponsePerPumpSecond 2.0 //drop in soil reading per pump second that always counts as an effect
+#define noEffectResponseFraction 0.25 //a response below this fraction of the usual one counts as no effect
+#define responseSmoothingFactor 0.3 //weight of the newest effective cycle in the usual response
+#define responseReadingDelayMillis 600000UL //the reading this long after a watering judges it, time for the water to reach the sensor
+
+//Tracks how much the soil reading drops per second of pumping, an empty reservoir shows up as cycles with no effect.
+//A watering the flow meter saw no water in has no effect whatever the reading does.
+class WateringResponseEstimator
+{
+    public:
+        void RecordWatering(double readingBefore, double pumpSeconds, bool flowDetected);
+        void RecordReading(double reading);
+        void DiscardWatering();
+        bool IsResponsePending();
+        bool IsReservoirEmpty();
+        uint8_t GetNoEffectCycles();
+        double GetLastResponsePerPumpSecond();
+        double GetUsualResponsePerPumpSecond();
+
+    private:
+        bool _wateringPending = false;
+        double _readingBefore = 0;
+        double _pumpSeconds = 0;
+        bool _flowDetected = true;
+        double _lastResponse = 0;
+        double _usualResponse = 0;
+        uint8_t _noEffectCycles = 0;
+};
+
+#endif
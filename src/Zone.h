@@ -0,0 +1,42 @@
+#ifndef Zone_h
+#define Zone_h
+#include <stdint.h>
+#include "WateringResponseEstimator.h"
+#include "DryingRateEstimator.h"
+#include "WateringController.h"
+
+#define numberOfZones 2 //each zone is one soil sensor on the multiplexer and one pump, at most 4 with two select pins
+
+//Per-zone settings and state, zone i reads multiplexer channel i
+struct Zone
+{
+    //Settings
+    int drynessAllowed = 350; //Threshold for when the watering should happen
+    int wateringTimeSeconds = 3; //amount of the water is sent from the pump to the plant
+    uint8_t soilReadingFrequencyMinutes = 45; //How often a soilreading should happen
+    int wateringMillilitres = 0; //volume per watering measured by the flow meter, 0 doses by wateringTimeSeconds instead
+
+    //State
+    unsigned long lastSoilReadingMillis = 0; //holds last millis() a reading was done
+    unsigned long lastWateringMillis = 0; //holds last millis() a watering was done
+    double lastWateredMillilitres = 0; //volume the flow meter counted during the last watering
+    bool lastWateringTimedOut = false; //the target volume was not reached before maxWateringSeconds
+    double lastDoseFraction = 0; //share of the configured dose the last watering used
+    double averageSoilReading = 0; //calculated soilreading
+    double soilReadingVariance = 0; //variance of the samples behind the last soilreading
+    unsigned long soilReadingSamples = 0; //samples behind the last soilreading
+    double soilReadingError = 0; //95% confidence half width of the last soilreading
+    double soilReadingSamplesPerSecond = 0;
+    unsigned long soilSensorOnMillis = 0; //sensor power on time of the last soilreading
+    bool soilSensorFault = false;
+    uint8_t unchangedSoilReadings = 0; //consecutive readings with no noise at all and the same value, a stuck ADC or sensor
+    bool notified = false; //refill SMS sent for the current empty reservoir
+    bool notificationPending = false; //refill SMS waiting for the notification task
+    double pendingDoseFraction = 0; //watering waiting for the watering task, 0 when none
+    WateringResponseEstimator wateringResponse;
+    DryingRateEstimator dryingRate;
+    WateringController controller;
+    unsigned long predictedSoilReadingIntervalMillis = 0; //from the drying slope, 0 until a slope is known
+};
+
+#endif
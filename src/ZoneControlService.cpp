@@ -0,0 +1,269 @@
+#include "ZoneControlService.h"
+
+void ZoneControlService::Begin(Zone* zones, const DigitalOutput* pumps, void (*onWatered)(uint8_t zone))
+{
+    _zones = zones;
+    _pumps = pumps;
+    _onWatered = onWatered;
+}
+
+void ZoneControlService::EvaluateSoilReading(uint8_t zone, const SoilReading& reading, const ZoneControlSettings& settings)
+{
+    Zone& z = _zones[zone];
+
+    double previousSoilReading = z.averageSoilReading;
+
+    z.averageSoilReading = reading.average;
+    z.soilReadingVariance = reading.variance;
+    z.soilReadingSamples = reading.samples;
+    z.soilReadingError = reading.error;
+    z.soilReadingSamplesPerSecond = reading.samplesPerSecond;
+    z.soilSensorOnMillis = reading.sensorOnMillis;
+
+    if(z.soilReadingVariance == 0 && z.averageSoilReading == previousSoilReading)
+    {
+        z.unchangedSoilReadings = z.unchangedSoilReadings < 255 ? z.unchangedSoilReadings + 1 : 255;
+    }
+    else
+    {
+        z.unchangedSoilReadings = 0;
+    }
+
+    z.soilSensorFault = IsSoilSensorFaulty(zone, reading.robustVariance, settings);
+
+    //Never water on a reading we cannot trust. Nor judge a watering on it, the zone would stay due for its response
+    //reading and be measured again on every tick.
+    if(z.soilSensorFault)
+    {
+        z.wateringResponse.DiscardWatering();
+        return;
+    }
+
+    z.wateringResponse.RecordReading(z.averageSoilReading);
+
+    //Far from the threshold the next reading can wait, close to it it comes sooner
+    z.dryingRate.AddReading(z.lastSoilReadingMillis, z.averageSoilReading);
+    z.predictedSoilReadingIntervalMillis = z.dryingRate.PredictNextIntervalMillis(z.drynessAllowed, _mathService.ConvertMinutesToMillis(settings.minSoilReadingIntervalMinutes), _mathService.ConvertMinutesToMillis(settings.maxSoilReadingIntervalMinutes));
+
+    //Waterings that stop moving the soil reading mean the pump is running dry
+    if(z.wateringResponse.IsReservoirEmpty() && !z.notified)
+    {
+        z.notificationPending = true;
+    }
+    else if(!z.wateringResponse.IsReservoirEmpty() && z.notified)
+    {
+        z.notified = false;
+    }
+
+    if(!settings.wateringAutomationEnabled)
+    {
+        return;
+    }
+
+    if(settings.wateringControlMode == PidControl)
+    {
+        double doseFraction = z.controller.Compute(z.averageSoilReading, z.drynessAllowed, z.lastSoilReadingMillis, settings.controllerGains);
+
+        if(doseFraction < minDoseFraction)
+        {
+            return;
+        }
+
+        z.pendingDoseFraction = doseFraction;
+        return;
+    }
+
+    if(z.averageSoilReading <= z.drynessAllowed)
+    {
+        return;
+    }
+
+    z.pendingDoseFraction = 1.0;
+}
+
+//The spread is judged on the group means, so a single ADC spike does not take a zone out of watering.
+//A stuck sensor only shows over several readings, one noiseless measurement is normal for a quiet ADC.
+bool ZoneControlService::IsSoilSensorFaulty(uint8_t zone, double robustVariance, const ZoneControlSettings& settings)
+{
+    return robustVariance > settings.maxSoilReadingVariance || _zones[zone].unchangedSoilReadings >= settings.stuckSoilReadingsBeforeFault;
+}
+
+//The most overdue zone, or -1 when no zone is due
+int ZoneControlService::GetNextDueZone(unsigned long nowMillis, const ZoneControlSettings& settings)
+{
+    int dueZone = -1;
+    unsigned long mostOverdueMillis = 0;
+
+    for(uint8_t zone = 0; zone < numberOfZones; zone++)
+    {
+        unsigned long elapsedMillis;
+        unsigned long intervalMillis;
+        GetSoilReadingTiming(zone, nowMillis, settings, elapsedMillis, intervalMillis);
+
+        if(elapsedMillis < intervalMillis)
+        {
+            continue;
+        }
+
+        if(dueZone < 0 || elapsedMillis - intervalMillis > mostOverdueMillis)
+        {
+            dueZone = zone;
+            mostOverdueMillis = elapsedMillis - intervalMillis;
+        }
+    }
+
+    return dueZone;
+}
+
+//Time since the reference point of the next reading and how long after it the reading is due. Only the elapsed
+//time is a difference of two clock readings, so nothing underflows, also across a millis() wrap
+void ZoneControlService::GetSoilReadingTiming(uint8_t zone, unsigned long nowMillis, const ZoneControlSettings& settings, unsigned long& elapsedMillis, unsigned long& intervalMillis)
+{
+    Zone& z = _zones[zone];
+
+    //A watering is judged on a reading once the water has soaked in, not a whole interval later when the soil has dried again
+    if(z.wateringResponse.IsResponsePending())
+    {
+        elapsedMillis = nowMillis - z.lastWateringMillis;
+        intervalMillis = responseReadingDelayMillis;
+        return;
+    }
+
+    elapsedMillis = nowMillis - z.lastSoilReadingMillis;
+
+    if(!settings.adaptiveSoilReadingEnabled || z.predictedSoilReadingIntervalMillis == 0)
+    {
+        intervalMillis = _mathService.ConvertMinutesToMillis(z.soilReadingFrequencyMinutes);
+        return;
+    }
+
+    intervalMillis = z.predictedSoilReadingIntervalMillis;
+}
+
+//0 once the zone is due
+unsigned long ZoneControlService::GetMillisUntilNextSoilReading(uint8_t zone, unsigned long nowMillis, const ZoneControlSettings& settings)
+{
+    unsigned long elapsedMillis;
+    unsigned long intervalMillis;
+    GetSoilReadingTiming(zone, nowMillis, settings, elapsedMillis, intervalMillis);
+
+    return elapsedMillis < intervalMillis ? intervalMillis - elapsedMillis : 0;
+}
+
+//The pump is polled every call while the other tasks keep running
+bool ZoneControlService::RunScheduledWatering(const ZoneControlSettings& settings)
+{
+    COROUTINE_BEGIN(_wateringCycle);
+
+    //A watering requested over HTTP may still be running, and replaces the pending one when it finishes
+    COROUTINE_WAIT_UNTIL(_wateringCycle, !_wateringInProgress && GetPendingWateringZone() >= 0);
+
+    {
+        uint8_t zone = GetPendingWateringZone();
+        StartWatering(zone, _zones[zone].pendingDoseFraction, settings);
+    }
+
+    COROUTINE_WAIT_UNTIL(_wateringCycle, IsWateringDone());
+
+    StopWatering();
+
+    COROUTINE_DELAY(_wateringCycle, settings.pumpSettleMillis);
+
+    FinishWatering(settings);
+
+    COROUTINE_END(_wateringCycle);
+}
+
+bool ZoneControlService::IsWateringCycleStarted()
+{
+    return _wateringCycle.IsStarted();
+}
+
+//Lowest zone first, -1 when no zone waits for a watering
+int ZoneControlService::GetPendingWateringZone()
+{
+    for(uint8_t zone = 0; zone < numberOfZones; zone++)
+    {
+        if(_zones[zone].pendingDoseFraction > 0)
+        {
+            return zone;
+        }
+    }
+
+    return -1;
+}
+
+//Only one pump runs at a time, callers check IsWateringInProgress() first.
+//doseFraction scales the configured seconds or millilitres.
+void ZoneControlService::StartWatering(uint8_t zone, double doseFraction, const ZoneControlSettings& settings)
+{
+    Zone& z = _zones[zone];
+
+    _wateringInProgress = true;
+    _wateringZone = zone;
+    _wateringDoseFraction = doseFraction;
+
+    //No point emptying the pump into a dry reservoir, only probe long enough to notice a refill
+    bool reservoirEmpty = z.wateringResponse.IsReservoirEmpty();
+
+    if(z.wateringMillilitres > 0)
+    {
+        //Dose by volume, the pump gets weaker as the reservoir empties so a fixed time drifts
+        double targetPulses = doseFraction * z.wateringMillilitres * settings.flowMeterPulsesPerLitre / 1000;
+        _pumpDoseService.Start(targetPulses < 1 ? 1 : targetPulses, _mathService.ConvertSecondsToMillis(reservoirEmpty ? settings.reservoirEmptyProbeSeconds : settings.maxWateringSeconds));
+    }
+    else
+    {
+        _pumpDoseService.Start(0, reservoirEmpty ? _mathService.ConvertSecondsToMillis(settings.reservoirEmptyProbeSeconds) : doseFraction * _mathService.ConvertSecondsToMillis(z.wateringTimeSeconds));
+    }
+
+    _waterPumpService.StartWaterPump(_pumps[zone]);
+}
+
+bool ZoneControlService::IsWateringDone()
+{
+    return _pumpDoseService.IsDone();
+}
+
+void ZoneControlService::StopWatering()
+{
+    _waterPumpService.StopWaterPump(_pumps[_wateringZone]);
+    _pumpDoseService.Stop();
+}
+
+//After the settle time, so the volume includes what drained through the flow meter
+void ZoneControlService::FinishWatering(const ZoneControlSettings& settings)
+{
+    Zone& z = _zones[_wateringZone];
+
+    z.lastWateringMillis = Coroutine::clock();
+    z.lastDoseFraction = _wateringDoseFraction;
+    z.pendingDoseFraction = 0; //a manual watering also replaces one that was waiting
+    z.lastWateredMillilitres = _pumpDoseService.GetMillilitres(settings.flowMeterPulsesPerLitre);
+    z.lastWateringTimedOut = _pumpDoseService.HasTimedOut();
+
+    //Watering starts a new drying curve, the fixed frequency is used until it has a slope again
+    z.dryingRate.Reset();
+    z.predictedSoilReadingIntervalMillis = 0;
+
+    //Without a volume target the flow meter is not relied on to be fitted
+    bool flowDetected = !_pumpDoseService.IsByVolume() || z.lastWateredMillilitres > 0;
+    z.wateringResponse.RecordWatering(z.averageSoilReading, _pumpDoseService.GetPumpMillis() / 1000.0, flowDetected);
+
+    _wateringInProgress = false;
+
+    if(_onWatered != nullptr)
+    {
+        _onWatered(_wateringZone);
+    }
+}
+
+bool ZoneControlService::IsWateringInProgress()
+{
+    return _wateringInProgress;
+}
+
+uint8_t ZoneControlService::GetWateringZone()
+{
+    return _wateringZone;
+}
@@ -0,0 +1,85 @@
+#ifndef ZoneControlService_h
+#define ZoneControlService_h
+#include "Zone.h"
+#include "Coroutine.h"
+#include "OutputPin.h"
+#include "PumpDoseService.h"
+#include "WaterPumpService.h"
+#include "MathService.h"
+
+enum WateringControlMode
+{
+    ThresholdControl, //fixed dose whenever the reading is above drynessAllowed
+    PidControl //dose computed from the error to drynessAllowed and its trend
+};
+
+struct ZoneControlSettings
+{
+    bool wateringAutomationEnabled;
+    WateringControlMode wateringControlMode;
+    WateringControllerGains controllerGains;
+    uint8_t stuckSoilReadingsBeforeFault; //a quiet ADC can read one value throughout a measurement, a stuck one keeps doing so
+    double maxSoilReadingVariance; //more robust spread than this means a loose wire or floating input
+    bool adaptiveSoilReadingEnabled;
+    uint8_t minSoilReadingIntervalMinutes;
+    uint8_t maxSoilReadingIntervalMinutes;
+    double flowMeterPulsesPerLitre;
+    int maxWateringSeconds; //volumetric watering stops here if the target volume is never reached
+    int reservoirEmptyProbeSeconds; //pump time while the reservoir is considered empty
+    unsigned long pumpSettleMillis; //the hose keeps draining through the flow meter after the pump stops
+};
+
+//Result of one soil measurement, as SoilMeasurementService reports it
+struct SoilReading
+{
+    double average;
+    double variance;
+    double robustVariance;
+    double error;
+    unsigned long samples;
+    double samplesPerSecond;
+    unsigned long sensorOnMillis;
+};
+
+//The per-zone decisions: when a zone is due for a reading, what a reading means for it and the pump run it leads to.
+//Time comes from Coroutine::clock and the pumps are OutputPins, so the flows run on the host with a simulated clock.
+class ZoneControlService
+{
+    public:
+        void Begin(Zone* zones, const DigitalOutput* pumps, void (*onWatered)(uint8_t zone));
+
+        void EvaluateSoilReading(uint8_t zone, const SoilReading& reading, const ZoneControlSettings& settings);
+        bool IsSoilSensorFaulty(uint8_t zone, double robustVariance, const ZoneControlSettings& settings);
+
+        int GetNextDueZone(unsigned long nowMillis, const ZoneControlSettings& settings);
+        unsigned long GetMillisUntilNextSoilReading(uint8_t zone, unsigned long nowMillis, const ZoneControlSettings& settings);
+
+        bool RunScheduledWatering(const ZoneControlSettings& settings);
+        bool IsWateringCycleStarted();
+        int GetPendingWateringZone();
+
+        void StartWatering(uint8_t zone, double doseFraction, const ZoneControlSettings& settings);
+        bool IsWateringDone();
+        void StopWatering();
+        void FinishWatering(const ZoneControlSettings& settings);
+        bool IsWateringInProgress();
+        uint8_t GetWateringZone();
+
+    private:
+        void GetSoilReadingTiming(uint8_t zone, unsigned long nowMillis, const ZoneControlSettings& settings, unsigned long& elapsedMillis, unsigned long& intervalMillis);
+
+        Zone* _zones = nullptr;
+        const DigitalOutput* _pumps = nullptr;
+        void (*_onWatered)(uint8_t zone) = nullptr;
+
+        Coroutine _wateringCycle;
+        PumpDoseService _pumpDoseService;
+        WaterPumpService _waterPumpService;
+        MathService _mathService;
+
+        bool _wateringInProgress = false; //a pump is running or settling, only one runs at a time
+        uint8_t _wateringZone = 0;
+        double _wateringDoseFraction = 0;
+};
+
+#endif
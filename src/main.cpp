@@ -1,8 +1,22 @@
 #include "Arduino.h"
-#include "WaterPumpService.h"
-#include "SoilSensorService.h"
+#include "SoilMeasurementService.h"
 #include "MathService.h"
-#include "UrlEncoderDecoder.h"
+#include "ProfilerService.h"
+#include "LoggerService.h"
+#include "MultiplexerService.h"
+#include "Zone.h"
+#include "ZoneControlService.h"
+#include "FlowMeterService.h"
+#include "PowerService.h"
+#include "RtcStateService.h"
+#include "SchedulerService.h"
+#include "Coroutine.h"
+#include "RateLimiterService.h"
+#include "NotificationService.h"
+#include "UdpTelemetryService.h"
+#include "ApiRequest.h"
+#include "MqttService.h"
+#include "SystemValueFields.h"
 #include <ESP8266WiFi.h>
 #include <ESP8266HttpClient.h>
 #include <WiFiClient.h>
@@ -12,8 +26,13 @@
  
  //GPIO
 #define soilSensorReadGPIO A0
-#define soilSensorActivateGPIO D5
-#define waterPumpGPIO D7
+#define flowMeterGPIO D2 //one flow sensor on the shared reservoir outlet, only one pump runs at a time. Not a boot strapping pin, the sensor output cannot hold one at the wrong level during reset
+
+//Output pins are resolved at compile time, an invalid pin is a build error
+constexpr DigitalOutput soilSensorPower = MakeDigitalOutput<D5>(); //powers all soil sensors, the multiplexer picks which one is read
+constexpr DigitalOutput multiplexerSelect0 = MakeDigitalOutput<D1>();
+constexpr DigitalOutput multiplexerSelect1 = MakeDigitalOutput<D8>(); //GPIO15 must be low at boot, the board pull-down keeps it there and the multiplexer input does not fight it
+constexpr DigitalOutput zoneWaterPumps[numberOfZones] = { MakeDigitalOutput<D7>(), MakeDigitalOutput<D6>() };
 
 
 //Server function definitions
@@ -23,219 +42,941 @@ void setMinDrynessAllowed();
 void daysBeforeNextReset();
 void healthCheck();
 void restServerRouting();
-void SendSMS(String message);
 void handleNotFound();
 void connectToWiFi();
 void requestWatering();
-void RunWateringCycle();
+void RunWateringCycle(byte zone, double doseFraction);
+void OnZoneWatered(byte zone);
+void NotifyRefill(byte zone);
+bool RunMeasurementCycle();
+bool RunSamplingCycle();
+bool RunNotificationCycle();
+bool HasPendingRefillNotification();
+void EvaluateSoilReading(byte zone);
+unsigned long GetIdleMillis();
+void StartSoilMeasurement(byte zone);
+unsigned long GetClockMillis();
+void RunDeepSleepCycle();
+bool WaitForWiFi(unsigned long timeoutMillis);
+void SendTelemetry(byte measuredZones);
+void SendUdpTelemetry(byte zone, TelemetryEvent event);
+void setUdpTelemetry();
+void PublishMqttEvent(byte zone, TelemetryEvent event);
+void handleMqttCommand(const String& command, const String& payload);
+void mqttTask();
+bool getZoneArg(byte& zone);
+SoilMeasurementSettings GetSoilMeasurementSettings();
+ZoneControlSettings GetZoneControlSettings();
 void setSoilReadingFrequencyMinutes();
 void setSoilReadingFrequencyMinutes();
 void getCurrentSoilReading();
-void setPercentageIncrease();
+void setSoilReadingTolerance();
+void setSoilSensorSettleMillis();
+void setWateringMillilitres();
+void toggleAdaptiveSoilReading();
+void setSoilReadingIntervalBounds();
+void setWateringControlMode();
+void setControllerGains();
+void setPowerSaveMode();
+void getProfilingValues();
+void resetProfilingValues();
+void getLogs();
+void getSchedulerValues();
+void resetSchedulerValues();
+void onRoute(const __FlashStringHelper* uri, HTTPMethod method, void (*handler)(), unsigned long costMillis = 5);
+void addTask(const __FlashStringHelper* name, TaskFunction run, unsigned long periodMillis, unsigned long deadlineMillis);
+void serveRoute(void (*handler)(), unsigned long costMillis);
+bool admitRequest(unsigned long costMillis);
+void countHttpConnection();
+void toggleHttpKeepAlive();
+void httpTask();
+void samplingTask();
+void wateringTask();
+void notificationTask();
+void measurementTask();
+void housekeepingTask();
 
 //Wifi variables and objects
 ESP8266WebServer server(80);
-HTTPClient client;
-WiFiClient wifiClient;
+ApiRequest api(server); //handlers read arguments and respond through this, so MQTT commands can reuse them
 
 const String _wifiName = WifiName;
 const String _wifiPassword = WifiPassword;
 
 const String CSCSIp = CSCSIp;
 const String SendSMSUrl = "/send-SMS";
+const String TelemetryUrl = "/telemetry";
 const String RefillWaterMessage = "Selfwatering system: Refill water";
 
+#ifndef MQTT_BROKER
+#define MQTT_BROKER "" //no broker, MQTT stays off. Set with -D MQTT_BROKER=\"host\" in platformio.ini
+#endif
+const String MqttBroker = MQTT_BROKER;
+const uint16_t MqttPort = 1883;
+const String MqttBaseTopic = "selfwatering/esp8266";
+
 
 //Core system variables
 unsigned long currentTimeMillis = millis(); //Current time
-int drynessAllowed = 350; //Threshold for when the watering should happen
-int wateringTimeSeconds = 3; //amount of the water is sent from the pump to the plant
-int lastWateringMillis = 0; //the amount of time passed since last watering
-byte soilReadingFrequencyMinutes = 45; //How often a soilreading should happen
-unsigned long lastSoilReadingMillis = 0; //holds last millis() a reading was done
-int numberOfSoilReadings = 1000; //number of soilreading done - avg is calculated
-double averageSoilReading = 0; //calculated soilreading
+unsigned long clockOffsetMillis = 0; //added to millis() so zone timestamps carry over deep sleep, where millis() restarts
+Zone zones[numberOfZones]; //per-zone thresholds, timings and state
+int minNumberOfSoilReadings = 20; //sampling never stops before this many samples
+int maxNumberOfSoilReadings = 1000; //sampling stops here even if the reading has not converged
+double soilReadingTolerance = 1.0; //sampling stops once the 95% confidence interval is within +/- this
+unsigned int soilSensorSettleMillis = 200; //time the sensor is powered before sampling starts
+bool soilMeasurementInProgress = false; //a scheduled measurement is settling or sampling
+byte measuringZone = 0; //zone of the scheduled measurement in progress
+byte stuckSoilReadingsBeforeFault = 4; //a quiet ADC can read one value throughout a measurement, a stuck one keeps doing so
+double maxSoilReadingVariance = 400; //more robust spread than this means a loose wire or floating input
 byte daysLeftBeforeReset = 1; //Reset system when currentTime is 1 day from reaching max value of unsigned long
 bool wateringAutomationEnabled = true;
-double percentageIncrease = 1.04; //percentage dryness is allowed to go above, before an SMS will be send
-bool notified = false;
-double soilReadingAfterSMS;
+double flowMeterPulsesPerLitre = 450; //YF-S201 datasheet value, calibrate by pumping into a measuring jug
+int maxWateringSeconds = 30; //volumetric watering stops here if the target volume is never reached
+bool adaptiveSoilReadingEnabled = true; //schedule readings from the drying slope instead of every soilReadingFrequencyMinutes
+byte minSoilReadingIntervalMinutes = 5; //adaptive readings are never closer than this
+byte maxSoilReadingIntervalMinutes = 120; //adaptive readings are never further apart than this
+WateringControlMode wateringControlMode = ThresholdControl;
+WateringControllerGains controllerGains = { 0.02, 0.0005, 0 }; //full dose at 50 above drynessAllowed, no derivative as readings are noisy. Tuned in test/test_watering_controller
+PowerSaveMode powerSaveMode = PowerSaveModem; //SDK default, light sleep also lets the CPU sleep between ticks
+byte lightSleepListenInterval = 3; //wake for every 3rd DTIM beacon in light sleep
+unsigned long maxIdleMillis = 100; //longest idle between handleClient() calls in light sleep, bounds the extra HTTP latency
+int reservoirEmptyProbeSeconds = 1; //pump time while the reservoir is considered empty, enough to notice a refill
+unsigned long pumpSettleMillis = 1000; //the hose keeps draining through the flow meter after the pump stops
+Coroutine measurementCycle;
+Coroutine samplingCycle;
+Coroutine notificationCycle;
+double maxHttpLoopShare = 0.5; //HTTP handlers together never block more than this share of the loop, the rest is left for watering
+RateLimiterSettings rateLimiterSettings = { 10000, maxHttpLoopShare * 1000, 6000, maxHttpLoopShare * 1000 / 2 }; //tokens are ms of blocked loop, one client gets half the share
+bool httpKeepAliveEnabled = true; //the server keeps one idle connection and drops it as soon as another client connects
+unsigned long httpRequests = 0;
+unsigned long httpConnections = 0; //requests on a new connection, with keep-alive working this stays well below httpRequests
+uint32_t lastHttpClientIp = 0;
+uint16_t lastHttpClientPort = 0;
+bool udpTelemetryEnabled = false; //a datagram per measurement and watering, for collectors that would otherwise poll
+IPAddress udpTelemetryAddress(239, 255, 87, 1); //multicast so any number of collectors on the LAN can listen
+uint16_t udpTelemetryPort = 5757;
+#define maxApiCommands 32
+struct ApiCommand
+{
+  const __FlashStringHelper* uri;
+  void (*handler)();
+};
+ApiCommand apiCommands[maxApiCommands]; //PUT routes, reachable over MQTT as <base>/cmd/<uri without the slash>
+byte numberOfApiCommands = 0;
+unsigned long wifiConnectTimeoutMillis = 10000; //a deep sleep wake gives up on reporting after this, the zones are still watered
+unsigned long lastAwakeMillis = 0; //wake to sleep time of the previous deep sleep wake
+unsigned long wakeCount = 0; //deep sleep wakes since the RTC state was last lost
 
 //Custom classes
-WaterPumpService waterPumpService;
-SoilSensorService soilSensorService;
+ZoneControlService zoneControlService;
+SoilMeasurementService soilMeasurementService;
+MultiplexerService multiplexerService;
+FlowMeterService flowMeterService;
+PowerService powerService;
+RtcStateService rtcStateService;
+SchedulerService schedulerService;
+RateLimiterService rateLimiterService;
 MathService mathService;
-UrlEncoderDecoderService urlEncoderDecoderService;
+NotificationService notificationService;
+UdpTelemetryService udpTelemetryService;
+MqttService mqttService;
+LoggerService loggerService;
+
+#ifdef ENABLE_PROFILING
+ProfilerService profilerService;
+byte loopSection;
+byte handleClientSection;
+byte samplingSection;
+byte wateringSection;
+byte notifySection;
+int profilerDumpSection = -1; //next section of a serial dump in progress, -1 when none is
+#endif
 
 
 void setup(void) 
 {
   Serial.begin(9600);
-  connectToWiFi();
-  pinMode(waterPumpGPIO, OUTPUT);
+
+  //Zone timestamps and every wait of the tasks read this clock, it carries over deep sleep
+  Coroutine::clock = GetClockMillis;
+
+#ifdef ENABLE_PROFILING
+  loopSection = profilerService.RegisterSection(F("loop"));
+  handleClientSection = profilerService.RegisterSection(F("handleClient"));
+  samplingSection = profilerService.RegisterSection(F("sampling"));
+  wateringSection = profilerService.RegisterSection(F("watering"));
+  notifySection = profilerService.RegisterSection(F("notify"));
+#endif
+
+  for(byte zone = 0; zone < numberOfZones; zone++)
+  {
+    zoneWaterPumps[zone].begin();
+  }
+
   pinMode(soilSensorReadGPIO, INPUT);
-  pinMode(soilSensorActivateGPIO, OUTPUT);
+  soilSensorPower.begin();
+  multiplexerSelect0.begin();
+  multiplexerSelect1.begin();
+  flowMeterService.Begin(flowMeterGPIO);
+  zoneControlService.Begin(zones, zoneWaterPumps, OnZoneWatered);
+
+  notificationService.Begin(CSCSIp, SendSMSUrl);
+  udpTelemetryService.SetDestination(udpTelemetryAddress, udpTelemetryPort);
+
+#ifdef ENABLE_DEEP_SLEEP
+  RunDeepSleepCycle(); //Does not return, the next wake starts over in setup()
+#endif
+
+  rateLimiterService.Begin(rateLimiterSettings);
+  connectToWiFi();
+  mqttService.Begin(MqttBroker, MqttPort, MqttBaseTopic, handleMqttCommand);
+  powerService.SetPowerSaveMode(powerSaveMode, lightSleepListenInterval);
+
+  //Table order is priority order within a tick
+  addTask(F("http"), httpTask, 0, 50);
+  addTask(F("sampling"), samplingTask, 0, 20);
+  addTask(F("watering"), wateringTask, 0, 20);
+  addTask(F("notification"), notificationTask, 1000, 5000);
+  addTask(F("measurement"), measurementTask, 1000, 100);
+  addTask(F("mqtt"), mqttTask, 50, mqttConnectTimeoutMillis + 100);
+  addTask(F("housekeeping"), housekeepingTask, 100, 100);
 }
  
 void loop(void) 
 {
-  
+  //Outside the loop section, idle time is not loop latency
+  powerService.Idle(GetIdleMillis());
+
+  PROFILE_SCOPE(profilerService, loopSection);
+
+  currentTimeMillis = GetClockMillis();
+
+  schedulerService.RunDueTasks();
+}
+
+//------------ Tasks ------------
+
+void httpTask()
+{
+  PROFILE_SCOPE(profilerService, handleClientSection);
   server.handleClient();
+}
+
+//Every activity is a task with its own coroutine, so the scheduler accounts run time and overruns per activity
+//and every wait yields back to it. They hand work on through zone state: a started measurement, pendingDoseFraction
+//and notificationPending.
+
+void measurementTask()
+{
+  RunMeasurementCycle();
+}
 
-  currentTimeMillis = millis();
+//Zones share the ADC, so only one is measured at a time and due zones take turns
+bool RunMeasurementCycle()
+{
+  COROUTINE_BEGIN(measurementCycle);
+
+  COROUTINE_WAIT_UNTIL(measurementCycle, wateringAutomationEnabled && !soilMeasurementService.IsRunning() && zoneControlService.GetNextDueZone(currentTimeMillis, GetZoneControlSettings()) >= 0);
+
+  measuringZone = zoneControlService.GetNextDueZone(currentTimeMillis, GetZoneControlSettings());
+  zones[measuringZone].lastSoilReadingMillis = currentTimeMillis;
+
+  StartSoilMeasurement(measuringZone);
+  soilMeasurementInProgress = true;
+
+  COROUTINE_END(measurementCycle);
+}
+
+//Idle runs stay out of the sampling histogram
+void samplingTask()
+{
+  if(!soilMeasurementInProgress)
+  {
+    return;
+  }
+
+  PROFILE_SCOPE(profilerService, samplingSection);
+  RunSamplingCycle();
+}
+
+//The measurement is advanced a chunk per run while the sensor settles and samples
+bool RunSamplingCycle()
+{
+  COROUTINE_BEGIN(samplingCycle);
+
+  COROUTINE_WAIT_UNTIL(samplingCycle, soilMeasurementService.Update());
+
+  soilMeasurementInProgress = false;
+  EvaluateSoilReading(measuringZone);
+  SendUdpTelemetry(measuringZone, TelemetryMeasurement);
+  PublishMqttEvent(measuringZone, TelemetryMeasurement);
+
+  COROUTINE_END(samplingCycle);
+}
+
+//Idle runs stay out of the watering histogram, a pump run in progress is in it from start to finish.
+//The pump is polled every tick while the other tasks keep running.
+void wateringTask()
+{
+  if(!zoneControlService.IsWateringCycleStarted() && zoneControlService.GetPendingWateringZone() < 0)
+  {
+    return;
+  }
+
+  PROFILE_SCOPE(profilerService, wateringSection);
+  zoneControlService.RunScheduledWatering(GetZoneControlSettings());
+}
+
+void notificationTask()
+{
+  RunNotificationCycle();
+}
+
+//Refill messages queued within a period go out together in one request once Wi-Fi is up
+bool RunNotificationCycle()
+{
+  COROUTINE_BEGIN(notificationCycle);
+
+  COROUTINE_WAIT_UNTIL(notificationCycle, HasPendingRefillNotification() || notificationService.HasPending());
+
+  for(byte zone = 0; zone < numberOfZones; zone++)
+  {
+    if(zones[zone].notificationPending)
+    {
+      NotifyRefill(zone);
+    }
+  }
+
+  COROUTINE_WAIT_UNTIL(notificationCycle, WiFi.status() == WL_CONNECTED);
+
+  {
+    PROFILE_SCOPE(profilerService, notifySection);
+    notificationService.Flush();
+  }
+
+  COROUTINE_END(notificationCycle);
+}
+
+bool HasPendingRefillNotification()
+{
+  for(byte zone = 0; zone < numberOfZones; zone++)
+  {
+    if(zones[zone].notificationPending)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void mqttTask()
+{
+  mqttService.Loop();
+}
+
+void housekeepingTask()
+{
+#ifdef ENABLE_PROFILING
+  //Send 'p' on the serial console to dump the histograms. The dump is several times the log ring, so it goes
+  //straight to the UART, one section per run, and the log waits until it is done so lines do not interleave
+  if(profilerDumpSection < 0 && Serial.available() > 0 && Serial.read() == 'p')
+  {
+    profilerService.PrintHeaderTo(Serial);
+    profilerDumpSection = 0;
+  }
+  else if(profilerDumpSection >= 0 && profilerDumpSection < profilerService.GetNumberOfSections())
+  {
+    profilerService.PrintSectionTo(Serial, profilerDumpSection++);
+  }
+  else
+  {
+    profilerDumpSection = -1;
+  }
+
+  if(profilerDumpSection < 0)
+  {
+    loggerService.Drain(Serial);
+  }
+#else
+  loggerService.Drain(Serial);
+#endif
 
   if(mathService.ConvertMillisToDays(ULONG_MAX - currentTimeMillis) <= daysLeftBeforeReset)
   {
     ESP.restart();
   }
+}
 
-  if(!wateringAutomationEnabled)
+//How long loop() may sleep before a periodic task is due, tasks run every tick are served after at most maxIdleMillis
+unsigned long GetIdleMillis()
+{
+  //Only light sleep needs the CPU idle to save anything, modem sleep keeps serving HTTP every tick
+  //The pump is checked every tick so a volume dose does not overshoot
+  if(powerSaveMode != PowerSaveLight || soilMeasurementInProgress || zoneControlService.IsWateringInProgress())
   {
-    return;
+    return 0;
   }
 
-  if((currentTimeMillis - lastSoilReadingMillis < mathService.ConvertMinutesToMillis(soilReadingFrequencyMinutes)))
+  return schedulerService.GetMillisUntilNextTask(maxIdleMillis);
+}
+
+void StartSoilMeasurement(byte zone)
+{
+  multiplexerService.SelectChannel(zone, multiplexerSelect0, multiplexerSelect1);
+  soilMeasurementService.Start(GetSoilMeasurementSettings());
+}
+
+void EvaluateSoilReading(byte zone)
+{
+  SoilReading reading;
+
+  reading.average = soilMeasurementService.GetReading();
+  reading.variance = soilMeasurementService.GetVariance();
+  reading.robustVariance = soilMeasurementService.GetRobustVariance();
+  reading.error = soilMeasurementService.GetError();
+  reading.samples = soilMeasurementService.GetSamples();
+  reading.samplesPerSecond = soilMeasurementService.GetSamplesPerSecond();
+  reading.sensorOnMillis = soilMeasurementService.GetSensorOnMillis();
+
+  zoneControlService.EvaluateSoilReading(zone, reading, GetZoneControlSettings());
+
+  if(zones[zone].soilSensorFault)
   {
-    return;
+    LOG_WARNING(loggerService, "Soil sensor fault in zone %d, robust variance %d, unchanged readings %d", zone, (int)reading.robustVariance, zones[zone].unchangedSoilReadings);
   }
-  
-  lastSoilReadingMillis = currentTimeMillis;
+}
+
+SoilMeasurementSettings GetSoilMeasurementSettings()
+{
+  SoilMeasurementSettings settings;
+
+  settings.readGpio = soilSensorReadGPIO;
+  settings.sensorPower = soilSensorPower;
+  settings.settleMillis = soilSensorSettleMillis;
+  settings.minSamples = minNumberOfSoilReadings;
+  settings.maxSamples = maxNumberOfSoilReadings;
+  settings.tolerance = soilReadingTolerance;
+
+  return settings;
+}
+
+ZoneControlSettings GetZoneControlSettings()
+{
+  ZoneControlSettings settings;
+
+  settings.wateringAutomationEnabled = wateringAutomationEnabled;
+  settings.wateringControlMode = wateringControlMode;
+  settings.controllerGains = controllerGains;
+  settings.stuckSoilReadingsBeforeFault = stuckSoilReadingsBeforeFault;
+  settings.maxSoilReadingVariance = maxSoilReadingVariance;
+  settings.adaptiveSoilReadingEnabled = adaptiveSoilReadingEnabled;
+  settings.minSoilReadingIntervalMinutes = minSoilReadingIntervalMinutes;
+  settings.maxSoilReadingIntervalMinutes = maxSoilReadingIntervalMinutes;
+  settings.flowMeterPulsesPerLitre = flowMeterPulsesPerLitre;
+  settings.maxWateringSeconds = maxWateringSeconds;
+  settings.reservoirEmptyProbeSeconds = reservoirEmptyProbeSeconds;
+  settings.pumpSettleMillis = pumpSettleMillis;
+
+  return settings;
+}
 
-  averageSoilReading = 0;
+//Blocks until the pump is off again, for callers that have to answer with the delivered volume.
+//doseFraction scales the configured seconds or millilitres.
+void RunWateringCycle(byte zone, double doseFraction)
+{
+  PROFILE_SCOPE(profilerService, wateringSection);
+
+  ZoneControlSettings settings = GetZoneControlSettings();
 
-  soilSensorService.ActivateSoilSensor(soilSensorActivateGPIO);
+  zoneControlService.StartWatering(zone, doseFraction, settings);
 
-  for(int i = 0; i < numberOfSoilReadings; i++)
+  while(!zoneControlService.IsWateringDone())
   {
-    averageSoilReading = averageSoilReading + soilSensorService.GetSensorReading(soilSensorReadGPIO);
+    delay(5); //Avoid watchdog in ESP8266 12E, short so the overshoot stays small
   }
 
-  soilSensorService.DisableSoilSensor(soilSensorActivateGPIO);
+  zoneControlService.StopWatering();
+  delay(pumpSettleMillis);
+  zoneControlService.FinishWatering(settings);
+}
+
+//Scheduled and requested waterings both end here once the hose has drained
+void OnZoneWatered(byte zone)
+{
+  if(zones[zone].lastWateringTimedOut)
+  {
+    LOG_WARNING(loggerService, "Zone %d watering timed out after %d ml", zone, (int)zones[zone].lastWateredMillilitres);
+  }
+
+  SendUdpTelemetry(zone, TelemetryWatering);
+  PublishMqttEvent(zone, TelemetryWatering);
+}
+
+//Queued for the notification task, a full outbox leaves notified false so it is queued again after the next reading
+void NotifyRefill(byte zone)
+{
+  Zone& z = zones[zone];
+
+  String message = RefillWaterMessage + " (zone " + String(zone) + ")";
+
+  mqttService.Publish("alert", message);
+  z.notified = notificationService.Queue(message);
+  z.notificationPending = false;
+}
+
+unsigned long GetClockMillis()
+{
+  return clockOffsetMillis + millis();
+}
+
+//------------ Deep sleep ------------
+
+//One battery powered wake: measure the due zones, water, report and sleep until the next zone is due.
+//Needs D0 wired to RST. The web server is never started, settings come from the defaults above.
+void RunDeepSleepCycle()
+{
+  bool stateRestored = rtcStateService.Restore(zones, clockOffsetMillis, lastAwakeMillis, wakeCount);
+  wakeCount = stateRestored ? wakeCount + 1 : 0;
+  currentTimeMillis = GetClockMillis();
 
-  averageSoilReading = averageSoilReading / numberOfSoilReadings;
+  byte dueZones = 0;
 
-  if(averageSoilReading <= drynessAllowed)
+  for(byte zone = 0; zone < numberOfZones; zone++)
   {
-    return;
+    //After a cold boot every zone is measured once, the saved timestamps are gone
+    if(!stateRestored || zoneControlService.GetMillisUntilNextSoilReading(zone, currentTimeMillis, GetZoneControlSettings()) == 0)
+    {
+      dueZones |= 1 << zone;
+    }
   }
 
-  
-  if((averageSoilReading > (drynessAllowed * percentageIncrease)) && !notified)
+  //Wakes that only bridge a sleep longer than deepSleepMax() do not touch the radio
+  if(dueZones != 0)
   {
-    soilReadingAfterSMS = averageSoilReading;
-    SendSMS(RefillWaterMessage);
-    notified = true;
+    //Measure with the radio still off, that is the only time the SDK burst read is allowed
+    //and no transmission disturbs the ADC
+    WiFi.persistent(false); //the credentials are compiled in, writing them to flash every wake only wears it
+    WiFi.mode(WIFI_OFF);
+
+    for(byte zone = 0; zone < numberOfZones; zone++)
+    {
+      if(dueZones & (1 << zone))
+      {
+        zones[zone].lastSoilReadingMillis = GetClockMillis();
+        StartSoilMeasurement(zone);
+        soilMeasurementService.WaitForReading();
+        EvaluateSoilReading(zone);
+      }
+    }
+
+    //Associating takes seconds, it runs while the pumps water
+    WiFi.mode(WIFI_STA);
+    WiFi.begin(_wifiName, _wifiPassword);
+
+    byte queuedZones = 0; //zones with a refill message in this wake's outbox
+
+    for(byte zone = 0; zone < numberOfZones; zone++)
+    {
+      if(!(dueZones & (1 << zone)))
+      {
+        continue;
+      }
+
+      if(zones[zone].pendingDoseFraction > 0)
+      {
+        RunWateringCycle(zone, zones[zone].pendingDoseFraction);
+      }
+
+      if(zones[zone].notificationPending)
+      {
+        NotifyRefill(zone);
+        queuedZones |= zones[zone].notified ? 1 << zone : 0;
+      }
+    }
+
+    //The outbox does not survive deep sleep, messages that could not be sent are queued again on the next wake.
+    //Zones notified on an earlier wake were sent then and stay notified.
+    if(!WaitForWiFi(wifiConnectTimeoutMillis) || !notificationService.Flush())
+    {
+      notificationService.Clear();
+
+      for(byte zone = 0; zone < numberOfZones; zone++)
+      {
+        if(queuedZones & (1 << zone))
+        {
+          zones[zone].notified = false;
+        }
+      }
+    }
+
+    SendTelemetry(dueZones);
   }
-  else if(notified && (averageSoilReading <= soilReadingAfterSMS))
+
+  currentTimeMillis = GetClockMillis();
+  unsigned long sleepMillis = ESP.deepSleepMax() / 1000;
+
+  for(byte zone = 0; zone < numberOfZones; zone++)
   {
-    notified = false;
-    soilReadingAfterSMS = 0;
+    sleepMillis = min(sleepMillis, zoneControlService.GetMillisUntilNextSoilReading(zone, currentTimeMillis, GetZoneControlSettings()));
   }
 
-  RunWateringCycle();
-    
+  sleepMillis = max(sleepMillis, 1000UL); //deepSleep(0) would never wake up
+
+  bool nextWakeBridges = true;
+
+  for(byte zone = 0; zone < numberOfZones; zone++)
+  {
+    if(zoneControlService.GetMillisUntilNextSoilReading(zone, currentTimeMillis + sleepMillis, GetZoneControlSettings()) == 0)
+    {
+      nextWakeBridges = false;
+    }
+  }
+
+  unsigned long awakeMillis = millis();
+  rtcStateService.Save(zones, currentTimeMillis + sleepMillis, awakeMillis, wakeCount);
+
+  LOG_INFO(loggerService, "Awake for %lu ms, sleeping %lu s", awakeMillis, sleepMillis / 1000);
+  loggerService.Drain(Serial);
+  Serial.flush();
+
+  ESP.deepSleep((uint64_t)sleepMillis * 1000, nextWakeBridges ? WAKE_RF_DISABLED : WAKE_RF_DEFAULT);
 }
 
-void RunWateringCycle()
+bool WaitForWiFi(unsigned long timeoutMillis)
 {
+  unsigned long startMillis = millis();
+
+  while(WiFi.status() != WL_CONNECTED)
+  {
+    if(millis() - startMillis >= timeoutMillis)
+    {
+      return false;
+    }
 
-  waterPumpService.StartWaterPump(waterPumpGPIO);
+    delay(50);
+  }
 
-  long waterPumpTime = millis();
+  return true;
+}
 
-  while(waterPumpTime - currentTimeMillis < mathService.ConvertSecondsToMillis(wateringTimeSeconds))
+//Short keys keep the report to one small packet: a = previous wake to sleep ms, n = wake count,
+//z = per zone [reading, last watered ml, flags], flags bit 0 measured now, 1 sensor fault, 2 reservoir empty
+void SendTelemetry(byte measuredZones)
+{
+  if(!WaitForWiFi(wifiConnectTimeoutMillis))
   {
-    waterPumpTime = millis();
-    delay(15); //Avoid watchdog in ESP8266 12E
+    LOG_WARNING(loggerService, "No WiFi, telemetry not sent");
+    return;
   }
 
-  waterPumpService.StopWaterPump(waterPumpGPIO);
+  DynamicJsonDocument doc(256);
+  doc["a"] = lastAwakeMillis;
+  doc["n"] = wakeCount;
+  JsonArray zoneReports = doc.createNestedArray("z");
 
-  lastWateringMillis = millis();
+  for(byte zone = 0; zone < numberOfZones; zone++)
+  {
+    Zone& z = zones[zone];
+    JsonArray zoneReport = zoneReports.createNestedArray();
+
+    zoneReport.add((int)z.averageSoilReading);
+    zoneReport.add((int)z.lastWateredMillilitres);
+    zoneReport.add((measuredZones & (1 << zone) ? 1 : 0) | (z.soilSensorFault ? 2 : 0) | (z.wateringResponse.IsReservoirEmpty() ? 4 : 0));
+  }
+
+  //Reuses the connection the refill messages went out on. Only a 2xx means the gateway took it, an error page is a positive code too
+  int httpCode = notificationService.Post(TelemetryUrl, doc.as<String>(), "application/json");
+
+  if(httpCode < 200 || httpCode >= 300)
+  {
+    LOG_WARNING(loggerService, "Telemetry not sent, HTTP %d", httpCode);
+  }
 }
 
+//Not used by the deep sleep cycle, it cannot be enabled there and its wake report is SendTelemetry()
+void SendUdpTelemetry(byte zone, TelemetryEvent event)
+{
+  //A datagram sent before Wi-Fi is up is dropped by the stack without an error
+  if(!udpTelemetryEnabled || WiFi.status() != WL_CONNECTED)
+  {
+    return;
+  }
 
- 
+  Zone& z = zones[zone];
+  TelemetryDatagram datagram;
+
+  datagram.event = event;
+  datagram.clockMillis = GetClockMillis();
+  datagram.zone = zone;
+  datagram.flags = (z.soilSensorFault ? telemetrySensorFault : 0) | (z.wateringResponse.IsReservoirEmpty() ? telemetryReservoirEmpty : 0) | (z.lastWateringTimedOut ? telemetryWateringTimedOut : 0) | (wateringAutomationEnabled ? telemetryAutomationEnabled : 0);
+  datagram.soilReadingTenths = constrain(z.averageSoilReading * 10, 0, UINT16_MAX);
+  datagram.soilReadingVarianceTenths = constrain(z.soilReadingVariance * 10, 0, UINT16_MAX);
+  datagram.drynessAllowed = constrain(z.drynessAllowed, 0, UINT16_MAX);
+  datagram.lastWateredMillilitres = constrain(z.lastWateredMillilitres, 0, UINT16_MAX);
+  datagram.lastDoseFractionThousandths = constrain(z.lastDoseFraction * 1000, 0, UINT16_MAX);
+
+  udpTelemetryService.Send(datagram);
+}
+
+//Readings go to <base>/zone/<n>/reading, pump events to <base>/zone/<n>/watering
+void PublishMqttEvent(byte zone, TelemetryEvent event)
+{
+  Zone& z = zones[zone];
+  DynamicJsonDocument doc(256);
+
+  if(event == TelemetryMeasurement)
+  {
+    doc["Reading"] = z.averageSoilReading;
+    doc["Variance"] = z.soilReadingVariance;
+    doc["SensorFault"] = z.soilSensorFault;
+    doc["DrynessAllowed"] = z.drynessAllowed;
+  }
+  else
+  {
+    doc["Millilitres"] = z.lastWateredMillilitres;
+    doc["DoseFraction"] = z.lastDoseFraction;
+    doc["TimedOut"] = z.lastWateringTimedOut;
+    doc["ReservoirEmpty"] = z.wateringResponse.IsReservoirEmpty();
+  }
 
+  mqttService.Publish("zone/" + String(zone) + (event == TelemetryMeasurement ? "/reading" : "/watering"), doc.as<String>());
+}
+
+//Runs the PUT handler of the same name with the payload as its arguments, the result goes to <base>/cmd-result/<command>
+void handleMqttCommand(const String& command, const String& payload)
+{
+  for(byte i = 0; i < numberOfApiCommands; i++)
+  {
+    if(String(apiCommands[i].uri).substring(1) != command)
+    {
+      continue;
+    }
+
+    api.BeginCommand(payload);
+    apiCommands[i].handler();
+    String result = String(api.GetResponseCode()) + " " + api.GetResponseBody();
+    api.EndCommand();
+
+    mqttService.Publish("cmd-result/" + command, result);
+    return;
+  }
+
+  mqttService.Publish("cmd-result/" + command, "404 Unknown command");
+}
 
 //------------ API ------------
 
-void SendSMS(String message)
+//The durations below were always sent as strings, plain JSON keeps that for existing pollers
+void setSystemValueNumber(JsonVariant value, double number, bool compact)
+{
+    if(compact)
+    {
+        value.set(number);
+    }
+    else
+    {
+        value.set(String(number));
+    }
+}
+
+//The rows of SystemValueFields.h with their read expressions. Short keys are sent when the client asks for keys=short or MessagePack.
+//compact is set in that case, the durations are then sent as numbers.
+struct SystemValueField
+{
+    const char* key;
+    const char* shortKey;
+    void (*read)(JsonVariant value, byte zone, bool compact);
+};
+
+#define SYSTEM_VALUE_READER(key, shortKey, kind, read) { key, shortKey, [](JsonVariant v, byte zone, bool compact) { read; } },
+
+const SystemValueField systemValueFields[] =
 {
-  client.begin(wifiClient, CSCSIp + SendSMSUrl + "?message=" + urlEncoderDecoderService.urlencode(message));
-  client.sendRequest("POST");
-  client.end();
-  Serial.println("Connection to " + CSCSIp + " has ended.");
+    SYSTEM_VALUE_FIELDS(SYSTEM_VALUE_READER)
+};
 
+//Matches the long or the short key, nullptr for an unknown name
+const SystemValueField* FindSystemValueField(const String& name)
+{
+    for(const SystemValueField& field : systemValueFields)
+    {
+        if(name == field.key || name == field.shortKey)
+        {
+            return &field;
+        }
+    }
+
+    return nullptr;
 }
 
+// Plain JSON by default, MessagePack with short keys for clients sending "Accept: application/msgpack".
+// keys=short selects the short keys for JSON as well.
+// fields=a,b,... (long or short keys) reads only those values, an empty fields= answers with an empty object
 void getSystemValues() 
 {
-    DynamicJsonDocument doc(1024);
-    doc["DrynessAllowedBeforeWatering"] = drynessAllowed;
-    doc["LastSoilReadingAverageValue"] = averageSoilReading;
-    doc["WateringTimeSeconds"] = wateringTimeSeconds;
-    doc["MinutesBetweenSoilReadings"] = soilReadingFrequencyMinutes;
-    doc["MinutesAgoSinceLastSoilReading"] = String(mathService.ConvertMillisToMinutes(currentTimeMillis - lastSoilReadingMillis));
-    doc["HoursAgoLastWateringCycleWasDone"] = String(mathService.ConvertMillisToHours(currentTimeMillis - lastWateringMillis));
-    doc["WateringAutomationEnabled"] = wateringAutomationEnabled;
-    doc["PercentageAboveDrynessAllowedBeforeSMS"] = percentageIncrease;
-
-    server.send(200, "text/json", doc.as<String>());
+    byte zone;
+
+    if(!getZoneArg(zone))
+    {
+        return;
+    }
+
+    bool msgPack = api.header("Accept").indexOf("application/msgpack") >= 0;
+    bool compact = msgPack || api.arg("keys") == "short";
+
+    bool selected = api.hasArg("fields");
+    String fields = api.arg("fields");
+
+    api.sendHeader("Vary", "Accept");
+
+    if(selected && fields.length() == 0)
+    {
+        //Nothing is read or serialized, an empty map is 0x80 in MessagePack
+        if(msgPack)
+        {
+            api.send(200, "application/msgpack", "\x80", 1);
+        }
+        else
+        {
+            api.send(200, "text/json", "{}");
+        }
+
+        return;
+    }
+
+    size_t numberOfFields = numberOfSystemValueFields;
+
+    if(selected)
+    {
+        numberOfFields = 1;
+
+        for(unsigned int i = 0; i < fields.length(); i++)
+        {
+            if(fields[i] == ',')
+            {
+                numberOfFields++;
+            }
+        }
+    }
+
+    //Fields picked by name are counted as durations, the list is short
+    DynamicJsonDocument doc(GetSystemValuesCapacity(numberOfFields, compact ? 0 : (selected ? numberOfFields : numberOfSystemValueDurations)));
+
+    if(!selected)
+    {
+        for(const SystemValueField& field : systemValueFields)
+        {
+            //doc[key] would hand the reader a null variant, only the proxy assignment adds the member
+            field.read(doc.getOrAddMember(compact ? field.shortKey : field.key), zone, compact);
+        }
+    }
+    else
+    {
+        unsigned int start = 0;
+
+        while(start <= fields.length())
+        {
+            int end = fields.indexOf(',', start);
+
+            if(end < 0)
+            {
+                end = fields.length();
+            }
+
+            String name = fields.substring(start, end);
+            const SystemValueField* field = FindSystemValueField(name);
+
+            if(field == nullptr)
+            {
+                api.send(400, "text/json", "Unknown field: " + name);
+                return;
+            }
+
+            field->read(doc.getOrAddMember(compact ? field->shortKey : field->key), zone, compact);
+            start = end + 1;
+        }
+    }
+
+    if(doc.overflowed())
+    {
+        LOG_ERROR(loggerService, "System values do not fit %u bytes", doc.capacity());
+        api.send(500, "text/json", "System values do not fit the document");
+        return;
+    }
+
+    if(!msgPack)
+    {
+        api.send(200, "text/json", doc.as<String>());
+        return;
+    }
+
+    size_t length = measureMsgPack(doc);
+    char* body = new char[length];
+    serializeMsgPack(doc, body, length);
+    api.send(200, "application/msgpack", body, length);
+    delete[] body;
 }
 
-void setPercentageIncrease()
+void setSoilReadingTolerance()
 {
-  String arg = "percentageIncrease";
+  String arg = "soilReadingTolerance";
 
-  if(!server.hasArg(arg))
+  if(!api.hasArg(arg))
   {
-    server.send(400, "text/json", "Missing argument: " + arg);
+    api.send(400, "text/json", "Missing argument: " + arg);
     return;
   }
 
-  double receivedPercentageIncrase = server.arg(arg).toDouble();
+  double receivedSoilReadingTolerance = api.arg(arg).toDouble();
 
-  if(receivedPercentageIncrase < 1.00 && receivedPercentageIncrase > 1.99)
+  if(receivedSoilReadingTolerance < 0.1 || receivedSoilReadingTolerance > 20)
   {
-    server.send(400, "text/json", "Value must be between 1.00 and 1.99");
+    api.send(400, "text/json", "Value must be between 0.1 and 20");
     return;
   }
 
-  percentageIncrease = receivedPercentageIncrase;
+  double oldSoilReadingTolerance = soilReadingTolerance;
+  soilReadingTolerance = receivedSoilReadingTolerance;
 
-  server.send(200, "text/json", "PercentageIncrease changed to " + String(percentageIncrease));
+  api.send(200, "text/json", "Soil reading tolerance changed from " + String(oldSoilReadingTolerance) + " to " + String(soilReadingTolerance));
 }
 
 void setWateringTimeSeconds()
 {
 
   String arg = "wateringTimeSeconds";
+  byte zone;
 
-  if(!server.hasArg(arg))
+  if(!getZoneArg(zone))
   {
-    server.send(400, "text/json", "Missing argument: " + arg);
     return;
   }
 
-  int receivedwateringTimeSeconds = server.arg(arg).toInt();
+  if(!api.hasArg(arg))
+  {
+    api.send(400, "text/json", "Missing argument: " + arg);
+    return;
+  }
+
+  int receivedwateringTimeSeconds = api.arg(arg).toInt();
 
   if(receivedwateringTimeSeconds == 0)
   {
-    server.send(400, "text/json", "Value could not be converted to an integer");
+    api.send(400, "text/json", "Value could not be converted to an integer");
     return;
   }
 
   if(receivedwateringTimeSeconds > 10)
   {
-    server.send(400, "text/json", "Value cannot be larger than 10");
+    api.send(400, "text/json", "Value cannot be larger than 10");
     return;
   }
 
-  int oldwateringTimeSeconds = wateringTimeSeconds;
-  wateringTimeSeconds = receivedwateringTimeSeconds;
+  int oldwateringTimeSeconds = zones[zone].wateringTimeSeconds;
+  zones[zone].wateringTimeSeconds = receivedwateringTimeSeconds;
 
-  server.send(200, "text/json", "wateringTimeSeconds changed from " + String(oldwateringTimeSeconds) + " to " + String(wateringTimeSeconds));
+  api.send(200, "text/json", "wateringTimeSeconds changed from " + String(oldwateringTimeSeconds) + " to " + String(zones[zone].wateringTimeSeconds));
 
 }
 
@@ -244,37 +985,43 @@ void setMinDrynessAllowed()
 {
 
   String arg = "minDrynessAllowed";
+  byte zone;
+
+  if(!getZoneArg(zone))
+  {
+    return;
+  }
 
-  if(!server.hasArg(arg))
+  if(!api.hasArg(arg))
   {
-    server.send(400, "text/json", "Missing argument: " + arg);
+    api.send(400, "text/json", "Missing argument: " + arg);
     return;
   }
 
-  int receivedMinDrynessAllowed = server.arg(arg).toInt();
+  int receivedMinDrynessAllowed = api.arg(arg).toInt();
 
   if(receivedMinDrynessAllowed == 0)
   {
-    server.send(400, "text/json", "Value could not be converted to an integer");
+    api.send(400, "text/json", "Value could not be converted to an integer");
     return;
   }
 
   if(receivedMinDrynessAllowed > 435)
   {
-    server.send(400, "text/json", "Max dryness allowed is 410. When measuring dry soil the value was 435 - 438");
+    api.send(400, "text/json", "Max dryness allowed is 410. When measuring dry soil the value was 435 - 438");
     return;
   }
 
   if(receivedMinDrynessAllowed < 350)
   {
-    server.send(400, "text/json", "Min dryness allowed is 350. When measuring newly watered soil the value was 285 - 287");
+    api.send(400, "text/json", "Min dryness allowed is 350. When measuring newly watered soil the value was 285 - 287");
     return;
   }
 
-  int oldMinDrynessAllowed = drynessAllowed;
-  drynessAllowed = receivedMinDrynessAllowed;
+  int oldMinDrynessAllowed = zones[zone].drynessAllowed;
+  zones[zone].drynessAllowed = receivedMinDrynessAllowed;
 
-  server.send(200, "text/json", "Minimum dryness allowed changed from " + String(oldMinDrynessAllowed) + " to " + String(drynessAllowed));
+  api.send(200, "text/json", "Minimum dryness allowed changed from " + String(oldMinDrynessAllowed) + " to " + String(zones[zone].drynessAllowed));
 
 }
 
@@ -282,31 +1029,37 @@ void setSoilReadingFrequencyMinutes()
 {
 
   String arg = "soilReadingFrequencyMinutes";
+  byte zone;
 
-  if(!server.hasArg(arg))
+  if(!getZoneArg(zone))
   {
-    server.send(400, "text/json", "Missing argument: " + arg);
     return;
   }
 
-  int receivedSoilReadingFrequencyMinutes = server.arg(arg).toInt();
+  if(!api.hasArg(arg))
+  {
+    api.send(400, "text/json", "Missing argument: " + arg);
+    return;
+  }
+
+  int receivedSoilReadingFrequencyMinutes = api.arg(arg).toInt();
 
   if(receivedSoilReadingFrequencyMinutes == 0)
   {
-    server.send(400, "text/json", "Value could not be converted to an integer");
+    api.send(400, "text/json", "Value could not be converted to an integer");
     return;
   }
 
   if(receivedSoilReadingFrequencyMinutes > 120)
   {
-    server.send(400, "text/json", "Value cannot be larger than 120");
+    api.send(400, "text/json", "Value cannot be larger than 120");
     return;
   }
 
-  int oldSoilReadingFrequencyMinutes = soilReadingFrequencyMinutes;
-  soilReadingFrequencyMinutes = receivedSoilReadingFrequencyMinutes;
+  int oldSoilReadingFrequencyMinutes = zones[zone].soilReadingFrequencyMinutes;
+  zones[zone].soilReadingFrequencyMinutes = receivedSoilReadingFrequencyMinutes;
 
-  server.send(200, "text/json", "Soil reading frequency changed from " + String(oldSoilReadingFrequencyMinutes) + " to " + String(soilReadingFrequencyMinutes));
+  api.send(200, "text/json", "Soil reading frequency changed from " + String(oldSoilReadingFrequencyMinutes) + " to " + String(zones[zone].soilReadingFrequencyMinutes));
 
 }
 
@@ -317,73 +1070,511 @@ void toggleWateringAutomationEnabled()
   if(wateringAutomationEnabled)
   {
     wateringAutomationEnabled = false;
-    server.send(200, "text/json", "Watering system DISABLED");
+    api.send(200, "text/json", "Watering system DISABLED");
   }
   else
   {
     wateringAutomationEnabled = true;
-    server.send(200, "text/json", "Watering system ENABLED");
+    api.send(200, "text/json", "Watering system ENABLED");
   }
 
   
 
 }
 
+void toggleHttpKeepAlive()
+{
+  httpKeepAliveEnabled = !httpKeepAliveEnabled;
+
+  //The header of this response already follows the new setting
+  server.keepAlive(httpKeepAliveEnabled);
+
+  api.send(200, "text/json", httpKeepAliveEnabled ? "HTTP keep-alive ENABLED" : "HTTP keep-alive DISABLED");
+}
+
+void setSoilSensorSettleMillis()
+{
+  String arg = "soilSensorSettleMillis";
+
+  if(!api.hasArg(arg))
+  {
+    api.send(400, "text/json", "Missing argument: " + arg);
+    return;
+  }
+
+  int receivedSoilSensorSettleMillis = api.arg(arg).toInt();
+
+  if(receivedSoilSensorSettleMillis < 0 || receivedSoilSensorSettleMillis > 5000)
+  {
+    api.send(400, "text/json", "Value must be between 0 and 5000");
+    return;
+  }
+
+  int oldSoilSensorSettleMillis = soilSensorSettleMillis;
+  soilSensorSettleMillis = receivedSoilSensorSettleMillis;
+
+  api.send(200, "text/json", "Soil sensor settle time changed from " + String(oldSoilSensorSettleMillis) + " to " + String(soilSensorSettleMillis));
+}
+
+void setWateringMillilitres()
+{
+  String arg = "wateringMillilitres";
+  byte zone;
+
+  if(!getZoneArg(zone))
+  {
+    return;
+  }
+
+  if(!api.hasArg(arg))
+  {
+    api.send(400, "text/json", "Missing argument: " + arg);
+    return;
+  }
+
+  int receivedWateringMillilitres = api.arg(arg).toInt();
+
+  if(receivedWateringMillilitres < 0 || receivedWateringMillilitres > 1000)
+  {
+    api.send(400, "text/json", "Value must be between 0 and 1000, 0 waters by time instead");
+    return;
+  }
+
+  int oldWateringMillilitres = zones[zone].wateringMillilitres;
+  zones[zone].wateringMillilitres = receivedWateringMillilitres;
+
+  api.send(200, "text/json", "Watering millilitres changed from " + String(oldWateringMillilitres) + " to " + String(zones[zone].wateringMillilitres));
+}
+
+void toggleAdaptiveSoilReading()
+{
+  adaptiveSoilReadingEnabled = !adaptiveSoilReadingEnabled;
+
+  api.send(200, "text/json", adaptiveSoilReadingEnabled ? "Adaptive soil reading ENABLED" : "Adaptive soil reading DISABLED");
+}
+
+void setSoilReadingIntervalBounds()
+{
+  String minArg = "minSoilReadingIntervalMinutes";
+  String maxArg = "maxSoilReadingIntervalMinutes";
+
+  if(!api.hasArg(minArg) || !api.hasArg(maxArg))
+  {
+    api.send(400, "text/json", "Missing argument: " + minArg + " and " + maxArg + " are required");
+    return;
+  }
+
+  int receivedMin = api.arg(minArg).toInt();
+  int receivedMax = api.arg(maxArg).toInt();
+
+  if(receivedMin < 1 || receivedMax > 240 || receivedMin > receivedMax)
+  {
+    api.send(400, "text/json", "Values must satisfy 1 <= min <= max <= 240");
+    return;
+  }
+
+  minSoilReadingIntervalMinutes = receivedMin;
+  maxSoilReadingIntervalMinutes = receivedMax;
+
+  api.send(200, "text/json", "Soil reading interval bounds changed to " + String(minSoilReadingIntervalMinutes) + " - " + String(maxSoilReadingIntervalMinutes) + " minutes");
+}
+
+void setUdpTelemetry()
+{
+  String enabledArg = "enabled";
+  String addressArg = "address";
+  String portArg = "port";
+
+  if(!api.hasArg(enabledArg))
+  {
+    api.send(400, "text/json", "Missing argument: " + enabledArg);
+    return;
+  }
+
+  IPAddress receivedAddress = udpTelemetryAddress;
+
+  if(api.hasArg(addressArg) && !receivedAddress.fromString(api.arg(addressArg)))
+  {
+    api.send(400, "text/json", "Address must be an IPv4 address");
+    return;
+  }
+
+  long receivedPort = api.hasArg(portArg) ? api.arg(portArg).toInt() : udpTelemetryPort;
+
+  if(receivedPort < 1 || receivedPort > 65535)
+  {
+    api.send(400, "text/json", "Port must be between 1 and 65535");
+    return;
+  }
+
+  udpTelemetryEnabled = api.arg(enabledArg).toInt() != 0;
+  udpTelemetryAddress = receivedAddress;
+  udpTelemetryPort = receivedPort;
+  udpTelemetryService.SetDestination(udpTelemetryAddress, udpTelemetryPort);
+
+  api.send(200, "text/json", "UDP telemetry " + String(udpTelemetryEnabled ? "ENABLED" : "DISABLED") + " to " + udpTelemetryAddress.toString() + ":" + String(udpTelemetryPort));
+}
+
+void setWateringControlMode()
+{
+  String arg = "wateringControlMode";
+
+  if(!api.hasArg(arg))
+  {
+    api.send(400, "text/json", "Missing argument: " + arg);
+    return;
+  }
+
+  String receivedWateringControlMode = api.arg(arg);
+
+  if(receivedWateringControlMode == "threshold")
+  {
+    wateringControlMode = ThresholdControl;
+  }
+  else if(receivedWateringControlMode == "pid")
+  {
+    wateringControlMode = PidControl;
+  }
+  else
+  {
+    api.send(400, "text/json", "Value must be threshold or pid");
+    return;
+  }
+
+  //Stale integrals from an earlier PID run would dump water on the first cycle
+  for(byte zone = 0; zone < numberOfZones; zone++)
+  {
+    zones[zone].controller.Reset();
+  }
+
+  api.send(200, "text/json", "Watering control mode changed to " + receivedWateringControlMode);
+}
+
+void setControllerGains()
+{
+  String args[] = { "kp", "ki", "kd" };
+  double* gains[] = { &controllerGains.kp, &controllerGains.ki, &controllerGains.kd };
+  double receivedGains[3];
+
+  for(byte i = 0; i < 3; i++)
+  {
+    receivedGains[i] = api.hasArg(args[i]) ? api.arg(args[i]).toDouble() : *gains[i];
+
+    if(receivedGains[i] < 0 || receivedGains[i] > 10)
+    {
+      api.send(400, "text/json", "Value of " + args[i] + " must be between 0 and 10");
+      return;
+    }
+  }
+
+  for(byte i = 0; i < 3; i++)
+  {
+    *gains[i] = receivedGains[i];
+  }
+
+  api.send(200, "text/json", "Controller gains changed to kp " + String(controllerGains.kp, 4) + " ki " + String(controllerGains.ki, 4) + " kd " + String(controllerGains.kd, 4));
+}
+
+void setPowerSaveMode()
+{
+  String arg = "powerSaveMode";
+  String listenIntervalArg = "listenInterval";
+
+  if(!api.hasArg(arg))
+  {
+    api.send(400, "text/json", "Missing argument: " + arg);
+    return;
+  }
+
+  String receivedPowerSaveMode = api.arg(arg);
+  PowerSaveMode mode;
+
+  if(receivedPowerSaveMode == "none")
+  {
+    mode = PowerSaveNone;
+  }
+  else if(receivedPowerSaveMode == "modem")
+  {
+    mode = PowerSaveModem;
+  }
+  else if(receivedPowerSaveMode == "light")
+  {
+    mode = PowerSaveLight;
+  }
+  else
+  {
+    api.send(400, "text/json", "Value must be none, modem or light");
+    return;
+  }
+
+  if(api.hasArg(listenIntervalArg))
+  {
+    int receivedListenInterval = api.arg(listenIntervalArg).toInt();
+
+    if(receivedListenInterval < 1 || receivedListenInterval > 10)
+    {
+      api.send(400, "text/json", "Listen interval must be between 1 and 10");
+      return;
+    }
+
+    lightSleepListenInterval = receivedListenInterval;
+  }
+
+  //Respond before switching, the radio may drop the connection while it changes mode
+  api.send(200, "text/json", "Power save mode changed to " + receivedPowerSaveMode);
+
+  powerSaveMode = mode;
+  powerService.SetPowerSaveMode(powerSaveMode, lightSleepListenInterval);
+}
+
 void daysBeforeNextReset()
 {
 
   double daysLeft = mathService.ConvertMillisToDays(ULONG_MAX - currentTimeMillis) - daysLeftBeforeReset;
 
-  server.send(200, "text/json", "System will reset in: " + String(daysLeft));
+  api.send(200, "text/json", "System will reset in: " + String(daysLeft));
 
 }
 
 void requestWatering()
 {
-  RunWateringCycle();
+  byte zone;
+
+  if(!getZoneArg(zone))
+  {
+    return;
+  }
+
+  //Handlers run between ticks, so a scheduled watering can be mid cycle
+  if(zoneControlService.IsWateringInProgress())
+  {
+    api.sendHeader("Retry-After", "5");
+    api.send(503, "text/json", "Watering of zone " + String(zoneControlService.GetWateringZone()) + " in progress");
+    return;
+  }
 
-  lastSoilReadingMillis = millis(); //Allow water to settle before next reading is done
+  RunWateringCycle(zone, 1.0); //the next reading of the zone waits responseReadingDelayMillis for the water to settle
 
-  server.send(200, "text/json", "Watering cycle completed");
+  api.send(200, "text/json", "Watering cycle completed, delivered ml: " + String(zones[zone].lastWateredMillilitres));
 
 }
 
 void getCurrentSoilReading()
 {
-  double soilReading = 0;
+  byte zone;
 
-  soilSensorService.ActivateSoilSensor(soilSensorActivateGPIO);
+  if(!getZoneArg(zone))
+  {
+    return;
+  }
+
+  //The multiplexer cannot be switched under a running measurement of another zone
+  if(soilMeasurementService.IsRunning() && (!soilMeasurementInProgress || measuringZone != zone))
+  {
+    api.sendHeader("Retry-After", "1");
+    api.send(503, "text/json", "Soil measurement of another zone in progress");
+    return;
+  }
 
-  for(int i = 0; i < numberOfSoilReadings; i++)
+  if(!soilMeasurementService.IsRunning())
   {
-    soilReading = soilReading + soilSensorService.GetSensorReading(soilSensorReadGPIO);
+    StartSoilMeasurement(zone);
   }
 
-  soilSensorService.DisableSoilSensor(soilSensorActivateGPIO);
+  double soilReading = soilMeasurementService.WaitForReading();
+
+  if(zoneControlService.IsSoilSensorFaulty(zone, soilMeasurementService.GetRobustVariance(), GetZoneControlSettings()))
+  {
+    api.send(500, "text/json", "Soil sensor fault, robust variance: " + String(soilMeasurementService.GetRobustVariance()));
+    return;
+  }
+
+  api.send(200, "text/json", "Soilreading: " + String(soilReading) + " variance: " + String(soilMeasurementService.GetVariance()) + " samples: " + String(soilMeasurementService.GetSamples()) + " error: " + String(soilMeasurementService.GetError()) + " samples/s: " + String(soilMeasurementService.GetSamplesPerSecond()) + " sensor on ms: " + String(soilMeasurementService.GetSensorOnMillis()));
+}
+
+void getProfilingValues()
+{
+#ifdef ENABLE_PROFILING
+  api.send(200, "text/json", profilerService.ToJson());
+#else
+  api.send(404, "text/json", "Profiling is disabled. Build with -D ENABLE_PROFILING");
+#endif
+}
 
-  soilReading = soilReading / numberOfSoilReadings;
+void resetProfilingValues()
+{
+#ifdef ENABLE_PROFILING
+  profilerService.Reset();
+  api.send(200, "text/json", "Profiling values reset");
+#else
+  api.send(404, "text/json", "Profiling is disabled. Build with -D ENABLE_PROFILING");
+#endif
+}
 
-  server.send(200, "text/json", "Soilreading: " + String(soilReading));
+void getLogs()
+{
+#ifdef ENABLE_LOG_ENDPOINT
+  api.send(200, "text/plain", loggerService.GetRecentLogs());
+#else
+  api.send(404, "text/json", "Log endpoint is disabled. Build with -D ENABLE_LOG_ENDPOINT");
+#endif
+}
+
+void getSchedulerValues()
+{
+  api.send(200, "text/json", schedulerService.ToJson());
+}
+
+void resetSchedulerValues()
+{
+  schedulerService.Reset();
+  api.send(200, "text/json", "Scheduler values reset");
+}
+
+// Reads the optional zone argument, zone 0 when it is missing. Responds 400 and returns false when it is out of range
+bool getZoneArg(byte& zone)
+{
+  String arg = "zone";
+  zone = 0;
+
+  if(!api.hasArg(arg))
+  {
+    return true;
+  }
+
+  int receivedZone = api.arg(arg).toInt();
+
+  if(receivedZone < 0 || receivedZone >= numberOfZones)
+  {
+    api.send(400, "text/json", "Zone must be between 0 and " + String(numberOfZones - 1));
+    return false;
+  }
+
+  zone = receivedZone;
+
+  return true;
 }
 
 void healthCheck()
 {
-  server.send(200, "text/json");
+  api.send(200, "text/json");
 }
 
 // Define routing
 void restServerRouting() 
 {
-    server.on(F("/run-watering-cycle"), HTTP_POST, requestWatering);
-    server.on(F("/health-check"), HTTP_GET, healthCheck);
-    server.on(F("/get-watering-system-values"), HTTP_GET, getSystemValues); 
-    server.on(F("/get-days-before-system-reset"), HTTP_GET, daysBeforeNextReset);
-    server.on(F("/get-current-soil-reading"), HTTP_GET, getCurrentSoilReading);
-    server.on(F("/set-watering-time-seconds"), HTTP_PUT, setWateringTimeSeconds);
-    server.on(F("/set-minimum-dryness-allowed"), HTTP_PUT, setMinDrynessAllowed);
-    server.on(F("/set-soil-reading-frequency"), HTTP_PUT, setSoilReadingFrequencyMinutes);
-    server.on(F("/toggle-watering-automation"), HTTP_PUT, toggleWateringAutomationEnabled);
-    server.on(F("/percentage-increase"), HTTP_PUT, setPercentageIncrease);
+    //Costs are roughly the milliseconds a handler blocks the loop, the default is 5
+    onRoute(F("/run-watering-cycle"), HTTP_POST, requestWatering, 5000);
+    onRoute(F("/health-check"), HTTP_GET, healthCheck, 0);
+    onRoute(F("/get-watering-system-values"), HTTP_GET, getSystemValues, 20); 
+    onRoute(F("/get-days-before-system-reset"), HTTP_GET, daysBeforeNextReset);
+    onRoute(F("/get-current-soil-reading"), HTTP_GET, getCurrentSoilReading, 500);
+    onRoute(F("/set-watering-time-seconds"), HTTP_PUT, setWateringTimeSeconds);
+    onRoute(F("/set-minimum-dryness-allowed"), HTTP_PUT, setMinDrynessAllowed);
+    onRoute(F("/set-soil-reading-frequency"), HTTP_PUT, setSoilReadingFrequencyMinutes);
+    onRoute(F("/toggle-watering-automation"), HTTP_PUT, toggleWateringAutomationEnabled);
+    onRoute(F("/set-soil-reading-tolerance"), HTTP_PUT, setSoilReadingTolerance);
+    onRoute(F("/set-soil-sensor-settle-millis"), HTTP_PUT, setSoilSensorSettleMillis);
+    onRoute(F("/set-watering-millilitres"), HTTP_PUT, setWateringMillilitres);
+    onRoute(F("/toggle-adaptive-soil-reading"), HTTP_PUT, toggleAdaptiveSoilReading);
+    onRoute(F("/set-soil-reading-interval-bounds"), HTTP_PUT, setSoilReadingIntervalBounds);
+    onRoute(F("/set-watering-control-mode"), HTTP_PUT, setWateringControlMode);
+    onRoute(F("/set-controller-gains"), HTTP_PUT, setControllerGains);
+    onRoute(F("/set-power-save-mode"), HTTP_PUT, setPowerSaveMode);
+    onRoute(F("/get-profiling-values"), HTTP_GET, getProfilingValues);
+    onRoute(F("/reset-profiling-values"), HTTP_PUT, resetProfilingValues);
+    onRoute(F("/logs"), HTTP_GET, getLogs);
+    onRoute(F("/get-scheduler-values"), HTTP_GET, getSchedulerValues);
+    onRoute(F("/toggle-http-keep-alive"), HTTP_PUT, toggleHttpKeepAlive);
+    onRoute(F("/set-udp-telemetry"), HTTP_PUT, setUdpTelemetry);
+    onRoute(F("/reset-scheduler-values"), HTTP_PUT, resetSchedulerValues);
+}
+
+// Register a periodic task, a full table is logged as the task would silently never run
+void addTask(const __FlashStringHelper* name, TaskFunction run, unsigned long periodMillis, unsigned long deadlineMillis)
+{
+  if(schedulerService.AddTask(name, run, periodMillis, deadlineMillis) == schedulerNoTask)
+  {
+    LOG_ERROR(loggerService, "Scheduler table full, %s never runs", String(name).c_str());
+  }
+}
+
+// Register a route, wrapped in its own profiling section when profiling is enabled
+void onRoute(const __FlashStringHelper* uri, HTTPMethod method, void (*handler)(), unsigned long costMillis)
+{
+  //Setters are also MQTT commands, they validate their arguments the same way
+  if(method == HTTP_PUT && numberOfApiCommands < maxApiCommands)
+  {
+    apiCommands[numberOfApiCommands++] = { uri, handler };
+  }
+
+#ifdef ENABLE_PROFILING
+  byte section = profilerService.RegisterSection(uri);
+
+  if(section == profilerNoSection)
+  {
+    LOG_ERROR(loggerService, "Profiler table full, %s is not profiled", String(uri).c_str());
+  }
+
+  server.on(uri, method, [section, handler, costMillis]()
+  {
+    PROFILE_SCOPE(profilerService, section);
+    serveRoute(handler, costMillis);
+  });
+#else
+  server.on(uri, method, [handler, costMillis]()
+  {
+    serveRoute(handler, costMillis);
+  });
+#endif
+}
+
+void serveRoute(void (*handler)(), unsigned long costMillis)
+{
+  countHttpConnection();
+
+  if(admitRequest(costMillis))
+  {
+    handler();
+  }
+}
+
+//A request from another address or port than the previous one came in on a new connection
+void countHttpConnection()
+{
+  WiFiClient httpClient = server.client();
+  uint32_t clientIp = httpClient.remoteIP();
+  uint16_t clientPort = httpClient.remotePort();
+
+  httpRequests++;
+
+  if(clientIp == lastHttpClientIp && clientPort == lastHttpClientPort)
+  {
+    return;
+  }
+
+  httpConnections++;
+  lastHttpClientIp = clientIp;
+  lastHttpClientPort = clientPort;
+
+  //Small responses on a reused connection would otherwise wait for the delayed ACK of the previous one
+  httpClient.setNoDelay(true);
+}
+
+//Responds 429 and returns false when the client or the device as a whole is over its request budget
+bool admitRequest(unsigned long costMillis)
+{
+  unsigned long retryAfterSeconds;
+
+  if(rateLimiterService.Admit(server.client().remoteIP(), costMillis, retryAfterSeconds))
+  {
+    return true;
+  }
+
+  api.sendHeader("Retry-After", String(retryAfterSeconds));
+  api.send(429, "text/json", "Too many requests, retry after " + String(retryAfterSeconds) + " s");
+
+  return false;
 }
 
 // Manage not found URL
@@ -410,31 +1601,33 @@ void connectToWiFi()
 {
   WiFi.mode(WIFI_STA);
   WiFi.begin(_wifiName, _wifiPassword);
-  Serial.println("");
+  LOG_INFO(loggerService, "Connecting to %s", _wifiName.c_str());
  
   // Wait for connection
   while (WiFi.status() != WL_CONNECTED) {
     delay(500);
-    Serial.print(".");
+    loggerService.Drain(Serial);
   }
-  Serial.println("");
-  Serial.print("Connected to ");
-  Serial.println(_wifiName);
-  Serial.print("IP address: ");
-  Serial.println(WiFi.localIP());
+  LOG_INFO(loggerService, "Connected to %s", _wifiName.c_str());
+  LOG_INFO(loggerService, "IP address: %s", WiFi.localIP().toString().c_str());
  
   // Activate mDNS this is used to be able to connect to the server
   // with local DNS hostmane esp8266.local
   if (MDNS.begin("esp8266")) {
-    Serial.println("MDNS responder started");
+    LOG_INFO(loggerService, "MDNS responder started");
   }
  
   // Set server routing
   restServerRouting();
   // Set not found response
   server.onNotFound(handleNotFound);
+  // Responses carry Content-Length, so the connection can stay open for the next request
+  server.keepAlive(httpKeepAliveEnabled);
+  // Only the headers listed here are kept, Accept selects the system values format
+  const char* collectedHeaders[] = { "Accept" };
+  server.collectHeaders(collectedHeaders, 1);
   // Start server
   server.begin();
 
-  Serial.println("HTTP server started");
+  LOG_INFO(loggerService, "HTTP server started");
 }
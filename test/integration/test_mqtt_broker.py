@@ -0,0 +1,172 @@
+"""Integration tests of the MQTT interface against a real broker and a running device.
+
+The device has to be built with -D MQTT_BROKER pointing at the same broker. The tests skip when
+MQTT_TEST_BROKER is not set or the broker cannot be reached, so they do not run in `pio test -e native`.
+
+    MQTT_TEST_BROKER=192.168.1.10 pytest test/integration
+    MQTT_TEST_BROKER=192.168.1.10:1884 MQTT_TEST_BASE_TOPIC=selfwatering/esp8266 pytest test/integration -v
+
+Only the standard library is used, the client below speaks just enough MQTT 3.1.1 for the tests: QoS 0
+publish, subscribe and retained messages.
+"""
+import os
+import socket
+import struct
+import time
+import uuid
+
+import pytest
+
+BASE_TOPIC = os.environ.get("MQTT_TEST_BASE_TOPIC", "selfwatering/esp8266")
+RESPONSE_TIMEOUT = 10  # the device polls the broker every tick, but a reconnect backs off for up to a minute
+
+
+def broker_address():
+    host, _, port = os.environ.get("MQTT_TEST_BROKER", "").partition(":")
+    return host, int(port or 1883)
+
+
+def encode_string(text):
+    data = text.encode()
+    return struct.pack("!H", len(data)) + data
+
+
+def encode_length(length):
+    encoded = bytearray()
+
+    while True:
+        byte, length = length % 128, length // 128
+        encoded.append(byte | (0x80 if length else 0))
+
+        if not length:
+            return bytes(encoded)
+
+
+class MqttTestClient:
+    def __init__(self, host, port):
+        self.socket = socket.create_connection((host, port), timeout=RESPONSE_TIMEOUT)
+        self.packet_id = 0
+        client_id = "selfwatering-test-" + uuid.uuid4().hex[:8]
+        variable_header = encode_string("MQTT") + bytes([4, 0x02]) + struct.pack("!H", 30)  # clean session, 30 s keep alive
+        self.send(0x10, variable_header + encode_string(client_id))
+        packet_type, body = self.receive()
+
+        if packet_type != 0x20 or body[1] != 0:
+            raise ConnectionError(f"broker refused the connection: {body!r}")
+
+    def send(self, header, body):
+        self.socket.sendall(bytes([header]) + encode_length(len(body)) + body)
+
+    def receive_exactly(self, count):
+        data = b""
+
+        while len(data) < count:
+            chunk = self.socket.recv(count - len(data))
+
+            if not chunk:
+                raise ConnectionError("broker closed the connection")
+
+            data += chunk
+
+        return data
+
+    def receive(self):
+        header = self.receive_exactly(1)[0]
+        length, shift = 0, 0
+
+        while True:
+            byte = self.receive_exactly(1)[0]
+            length |= (byte & 0x7F) << shift
+            shift += 7
+
+            if not byte & 0x80:
+                break
+
+        return header & 0xF0, self.receive_exactly(length)
+
+    def subscribe(self, topic):
+        self.packet_id += 1
+        self.send(0x82, struct.pack("!H", self.packet_id) + encode_string(topic) + bytes([0]))
+
+        while self.receive()[0] != 0x90:
+            pass
+
+    def publish(self, topic, payload, retained=False):
+        self.send(0x30 | (1 if retained else 0), encode_string(topic) + payload.encode())
+
+    def wait_for(self, topic, timeout=RESPONSE_TIMEOUT):
+        """Payload of the next message on topic, None on timeout."""
+        deadline = time.monotonic() + timeout
+
+        while time.monotonic() < deadline:
+            self.socket.settimeout(max(0.1, deadline - time.monotonic()))
+
+            try:
+                packet_type, body = self.receive()
+            except socket.timeout:
+                return None
+
+            if packet_type != 0x30:
+                continue
+
+            topic_length = struct.unpack("!H", body[:2])[0]
+            received_topic = body[2:2 + topic_length].decode()
+
+            if received_topic == topic:
+                return body[2 + topic_length:].decode()
+
+        return None
+
+    def close(self):
+        self.send(0xE0, b"")
+        self.socket.close()
+
+
+@pytest.fixture
+def client():
+    host, port = broker_address()
+
+    if not host:
+        pytest.skip("MQTT_TEST_BROKER is not set")
+
+    try:
+        mqtt = MqttTestClient(host, port)
+    except OSError as error:
+        pytest.skip(f"broker {host}:{port} not reachable: {error}")
+
+    yield mqtt
+    mqtt.close()
+
+
+def run_command(client, command, payload=""):
+    result_topic = f"{BASE_TOPIC}/cmd-result/{command}"
+    client.subscribe(result_topic)
+    client.publish(f"{BASE_TOPIC}/cmd/{command}", payload)
+
+    return client.wait_for(result_topic)
+
+
+def test_device_is_online(client):
+    # Retained, and replaced by the broker with the "offline" will when the device drops off
+    client.subscribe(f"{BASE_TOPIC}/status")
+
+    assert client.wait_for(f"{BASE_TOPIC}/status") == "online"
+
+
+def test_unknown_command_is_answered(client):
+    assert run_command(client, "no-such-command") == "404 Unknown command"
+
+
+def test_setter_runs_the_put_handler(client):
+    result = run_command(client, "set-soil-reading-tolerance", "soilReadingTolerance=1")
+
+    assert result is not None, "no cmd-result within the timeout"
+    assert result.startswith("200 ")
+
+
+def test_setter_rejects_bad_arguments_like_http(client):
+    result = run_command(client, "set-soil-reading-tolerance", "")
+
+    assert result is not None, "no cmd-result within the timeout"
+    assert result.split(" ")[0].startswith("4")
+
@@ -0,0 +1,148 @@
+#include <unity.h>
+#include <limits.h>
+#include "Coroutine.h"
+#include "ZoneControlService.h"
+
+//The zone tasks read time only through Coroutine::clock, here it is a simulated clock the tests advance by hand
+
+#define settleMillis 1000
+#define tickMillis 20
+
+unsigned long simulatedMillis = 0;
+
+unsigned long SimulatedClock()
+{
+    return simulatedMillis;
+}
+
+void setUp()
+{
+    simulatedMillis = 0;
+    Coroutine::clock = SimulatedClock;
+}
+
+void tearDown() {}
+
+//Stands in for the sampling task, one chunk per run
+struct SamplingTask
+{
+    Coroutine cycle;
+    int chunksLeft = 0;
+    int chunks = 0;
+
+    bool SampleChunk()
+    {
+        if(chunksLeft == 0)
+        {
+            return false;
+        }
+
+        chunks++;
+        return --chunksLeft == 0;
+    }
+
+    bool Run()
+    {
+        COROUTINE_BEGIN(cycle);
+
+        COROUTINE_WAIT_UNTIL(cycle, SampleChunk());
+
+        COROUTINE_END(cycle);
+    }
+};
+
+void test_delay_follows_the_clock()
+{
+    Coroutine coroutine;
+    int runs = 0;
+
+    auto run = [&]() -> bool
+    {
+        COROUTINE_BEGIN(coroutine);
+        runs++;
+        COROUTINE_DELAY(coroutine, 500);
+        runs++;
+        COROUTINE_END(coroutine);
+    };
+
+    TEST_ASSERT_FALSE(run());
+    TEST_ASSERT_EQUAL_INT(1, runs);
+    TEST_ASSERT_TRUE(coroutine.IsStarted());
+
+    simulatedMillis = 499;
+    TEST_ASSERT_FALSE(run());
+    TEST_ASSERT_EQUAL_INT(1, runs);
+
+    simulatedMillis = 500;
+    TEST_ASSERT_TRUE(run());
+    TEST_ASSERT_EQUAL_INT(2, runs);
+    TEST_ASSERT_FALSE(coroutine.IsStarted());
+}
+
+void test_delay_survives_clock_wrap()
+{
+    Coroutine coroutine;
+
+    auto run = [&]() -> bool
+    {
+        COROUTINE_BEGIN(coroutine);
+        COROUTINE_DELAY(coroutine, 100);
+        COROUTINE_END(coroutine);
+    };
+
+    simulatedMillis = ULONG_MAX - 49; //unsigned long is 64 bit on the host, 32 on the ESP8266
+    TEST_ASSERT_FALSE(run());
+
+    simulatedMillis = 49;
+    TEST_ASSERT_FALSE(run());
+
+    simulatedMillis = 50;
+    TEST_ASSERT_TRUE(run());
+}
+
+//The reason for separate coroutines: a measurement started while a pump runs is sampled every tick,
+//the watering does not hold the scheduler until it is done
+void test_sampling_runs_while_the_pump_runs()
+{
+    Zone zones[numberOfZones];
+    const DigitalOutput pumps[numberOfZones] = { MakeDigitalOutput<13>(), MakeDigitalOutput<12>() };
+    ZoneControlService zoneControlService;
+    ZoneControlSettings settings = {};
+    SamplingTask sampling;
+
+    settings.pumpSettleMillis = settleMillis;
+    zoneControlService.Begin(zones, pumps, nullptr);
+    zones[0].wateringTimeSeconds = 3;
+    zones[0].pendingDoseFraction = 1.0;
+    sampling.chunksLeft = 10;
+
+    unsigned long samplingDoneMillis = 0;
+    bool wateringDone = false;
+
+    for(int tick = 0; tick < 1000 && !wateringDone; tick++)
+    {
+        if(sampling.Run() && samplingDoneMillis == 0)
+        {
+            samplingDoneMillis = simulatedMillis;
+        }
+
+        wateringDone = zoneControlService.RunScheduledWatering(settings);
+        simulatedMillis += tickMillis;
+    }
+
+    TEST_ASSERT_TRUE(wateringDone);
+    TEST_ASSERT_EQUAL_INT(10, sampling.chunks);
+    TEST_ASSERT_TRUE(samplingDoneMillis < 3000);
+
+    //Finishes on the first tick at the end of the settle time
+    TEST_ASSERT_EQUAL_UINT32(3000 + settleMillis, zones[0].lastWateringMillis);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_delay_follows_the_clock);
+    RUN_TEST(test_delay_survives_clock_wrap);
+    RUN_TEST(test_sampling_runs_while_the_pump_runs);
+    return UNITY_END();
+}
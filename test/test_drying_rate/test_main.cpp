@@ -0,0 +1,78 @@
+#include <unity.h>
+#include "DryingRateEstimator.h"
+
+#define minIntervalMillis 300000UL
+#define maxIntervalMillis 7200000UL
+#define threshold 350.0
+
+void setUp() {}
+void tearDown() {}
+
+void test_no_prediction_without_a_slope()
+{
+    DryingRateEstimator estimator;
+
+    TEST_ASSERT_EQUAL_UINT32(0, estimator.PredictNextIntervalMillis(threshold, minIntervalMillis, maxIntervalMillis));
+
+    estimator.AddReading(0, 300);
+    TEST_ASSERT_EQUAL_UINT32(0, estimator.PredictNextIntervalMillis(threshold, minIntervalMillis, maxIntervalMillis));
+
+    //Two readings at the same time have no slope either
+    estimator.AddReading(0, 305);
+    TEST_ASSERT_EQUAL_UINT32(0, estimator.PredictNextIntervalMillis(threshold, minIntervalMillis, maxIntervalMillis));
+}
+
+void test_reset_drops_the_prediction()
+{
+    DryingRateEstimator estimator;
+
+    estimator.AddReading(0, 300);
+    estimator.AddReading(600000, 310);
+    TEST_ASSERT_TRUE(estimator.PredictNextIntervalMillis(threshold, minIntervalMillis, maxIntervalMillis) > 0);
+
+    estimator.Reset();
+    TEST_ASSERT_EQUAL_UINT32(0, estimator.PredictNextIntervalMillis(threshold, minIntervalMillis, maxIntervalMillis));
+}
+
+void test_predicts_the_threshold_crossing()
+{
+    DryingRateEstimator estimator;
+
+    //1 per minute, 40 to go: 40 minutes, measured at the 80% margin
+    estimator.AddReading(0, 300);
+    estimator.AddReading(600000, 310);
+
+    TEST_ASSERT_EQUAL_UINT32(40 * 60000UL * predictionMarginFraction, estimator.PredictNextIntervalMillis(threshold, minIntervalMillis, maxIntervalMillis));
+}
+
+void test_prediction_is_clamped()
+{
+    DryingRateEstimator estimator;
+
+    //Wetter over time
+    estimator.AddReading(0, 310);
+    estimator.AddReading(600000, 300);
+    TEST_ASSERT_EQUAL_UINT32(maxIntervalMillis, estimator.PredictNextIntervalMillis(threshold, minIntervalMillis, maxIntervalMillis));
+
+    //Past the threshold already
+    estimator.Reset();
+    estimator.AddReading(0, 340);
+    estimator.AddReading(600000, 360);
+    TEST_ASSERT_EQUAL_UINT32(minIntervalMillis, estimator.PredictNextIntervalMillis(threshold, minIntervalMillis, maxIntervalMillis));
+
+    //Drying so slowly the crossing is days away
+    estimator.Reset();
+    estimator.AddReading(0, 300);
+    estimator.AddReading(6000000, 301);
+    TEST_ASSERT_EQUAL_UINT32(maxIntervalMillis, estimator.PredictNextIntervalMillis(threshold, minIntervalMillis, maxIntervalMillis));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_no_prediction_without_a_slope);
+    RUN_TEST(test_reset_drops_the_prediction);
+    RUN_TEST(test_predicts_the_threshold_crossing);
+    RUN_TEST(test_prediction_is_clamped);
+    return UNITY_END();
+}
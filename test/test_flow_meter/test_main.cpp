@@ -0,0 +1,82 @@
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include "FlowMeterService.h"
+
+//A thread stands in for the YF-S201 and calls the interrupt handler the way the pin interrupt would
+
+#define pulsesPerLitre 450.0
+
+void setUp()
+{
+    FlowMeterService flowMeterService;
+    flowMeterService.ResetPulses();
+}
+
+void tearDown() {}
+
+void SimulatePulses(unsigned long count)
+{
+    for(unsigned long i = 0; i < count; i++)
+    {
+        FlowMeterService::OnPulse();
+    }
+}
+
+void test_pulses_convert_to_millilitres()
+{
+    FlowMeterService flowMeterService;
+
+    SimulatePulses(450);
+    TEST_ASSERT_EQUAL_UINT32(450, flowMeterService.GetPulses());
+    TEST_ASSERT_DOUBLE_WITHIN(0.001, 1000, flowMeterService.GetMillilitres(pulsesPerLitre));
+
+    SimulatePulses(45);
+    TEST_ASSERT_DOUBLE_WITHIN(0.001, 1100, flowMeterService.GetMillilitres(pulsesPerLitre));
+}
+
+void test_reset_starts_a_new_dose()
+{
+    FlowMeterService flowMeterService;
+
+    SimulatePulses(100);
+    flowMeterService.ResetPulses();
+    TEST_ASSERT_EQUAL_UINT32(0, flowMeterService.GetPulses());
+    TEST_ASSERT_EQUAL_DOUBLE(0, flowMeterService.GetMillilitres(pulsesPerLitre));
+}
+
+//The watering task polls while pulses arrive, the count it sees must only grow and end at the total
+void test_count_while_pulses_arrive()
+{
+    FlowMeterService flowMeterService;
+    const unsigned long totalPulses = 100000;
+    std::atomic<bool> done(false);
+
+    std::thread sensor([&]()
+    {
+        SimulatePulses(totalPulses);
+        done = true;
+    });
+
+    unsigned long previous = 0;
+
+    while(!done)
+    {
+        unsigned long pulses = flowMeterService.GetPulses();
+        TEST_ASSERT_TRUE(pulses >= previous);
+        TEST_ASSERT_TRUE(pulses <= totalPulses);
+        previous = pulses;
+    }
+
+    sensor.join();
+    TEST_ASSERT_EQUAL_UINT32(totalPulses, flowMeterService.GetPulses());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_pulses_convert_to_millilitres);
+    RUN_TEST(test_reset_starts_a_new_dose);
+    RUN_TEST(test_count_while_pulses_arrive);
+    return UNITY_END();
+}
@@ -0,0 +1,89 @@
+#include <unity.h>
+#include "OutputPin.h"
+#include "MultiplexerService.h"
+
+//Off target OutputPin writes to MockGpio, so the pin levels the firmware leaves behind can be checked
+
+//GPIO numbers of the pins main.cpp uses: D5, D1, D8, D7 and D6
+constexpr DigitalOutput soilSensorPower = MakeDigitalOutput<14>();
+constexpr DigitalOutput multiplexerSelect0 = MakeDigitalOutput<5>();
+constexpr DigitalOutput multiplexerSelect1 = MakeDigitalOutput<15>();
+constexpr DigitalOutput zoneWaterPumps[] = { MakeDigitalOutput<13>(), MakeDigitalOutput<12>() };
+
+void setUp()
+{
+    for(uint8_t pin = 0; pin <= 16; pin++)
+    {
+        MockGpio::levels[pin] = LOW;
+        MockGpio::modes[pin] = 0;
+    }
+}
+
+void tearDown() {}
+
+void test_begin_makes_the_pin_an_output()
+{
+    soilSensorPower.begin();
+
+    TEST_ASSERT_EQUAL_UINT8(OUTPUT, MockGpio::modes[14]);
+    TEST_ASSERT_EQUAL_UINT8(0, MockGpio::modes[13]);
+}
+
+void test_high_and_low_only_touch_their_pin()
+{
+    OutputPin<13>::High();
+
+    TEST_ASSERT_EQUAL_UINT8(HIGH, MockGpio::levels[13]);
+    TEST_ASSERT_EQUAL_UINT8(LOW, MockGpio::levels[12]);
+
+    OutputPin<13>::Low();
+
+    TEST_ASSERT_EQUAL_UINT8(LOW, MockGpio::levels[13]);
+}
+
+void test_runtime_handles_switch_the_right_pump()
+{
+    zoneWaterPumps[1].high();
+
+    TEST_ASSERT_EQUAL_UINT8(LOW, MockGpio::levels[13]);
+    TEST_ASSERT_EQUAL_UINT8(HIGH, MockGpio::levels[12]);
+
+    zoneWaterPumps[1].low();
+
+    TEST_ASSERT_EQUAL_UINT8(LOW, MockGpio::levels[12]);
+}
+
+void test_multiplexer_selects_every_channel()
+{
+    MultiplexerService multiplexerService;
+
+    for(uint8_t channel = 0; channel < 4; channel++)
+    {
+        multiplexerService.SelectChannel(channel, multiplexerSelect0, multiplexerSelect1);
+
+        TEST_ASSERT_EQUAL_UINT8(channel & 0x01 ? HIGH : LOW, MockGpio::levels[5]);
+        TEST_ASSERT_EQUAL_UINT8(channel & 0x02 ? HIGH : LOW, MockGpio::levels[15]);
+    }
+}
+
+//GPIO15 is a strapping pin that has to be low at boot, selecting zone 0 and 1 keeps it there
+void test_first_two_zones_leave_gpio15_low()
+{
+    MultiplexerService multiplexerService;
+
+    multiplexerService.SelectChannel(3, multiplexerSelect0, multiplexerSelect1);
+    multiplexerService.SelectChannel(1, multiplexerSelect0, multiplexerSelect1);
+
+    TEST_ASSERT_EQUAL_UINT8(LOW, MockGpio::levels[15]);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_begin_makes_the_pin_an_output);
+    RUN_TEST(test_high_and_low_only_touch_their_pin);
+    RUN_TEST(test_runtime_handles_switch_the_right_pump);
+    RUN_TEST(test_multiplexer_selects_every_channel);
+    RUN_TEST(test_first_two_zones_leave_gpio15_low);
+    return UNITY_END();
+}
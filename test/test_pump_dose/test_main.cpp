@@ -0,0 +1,139 @@
+#include <unity.h>
+#include "Coroutine.h"
+#include "PumpDoseService.h"
+
+//PumpDoseService reads time through Coroutine::clock and pulses from FlowMeterService, the test drives both
+
+#define pulsesPerLitre 450.0
+
+unsigned long simulatedMillis = 0;
+
+unsigned long SimulatedClock()
+{
+    return simulatedMillis;
+}
+
+void setUp()
+{
+    simulatedMillis = 0;
+    Coroutine::clock = SimulatedClock;
+}
+
+void tearDown() {}
+
+void SimulatePulses(unsigned long count)
+{
+    for(unsigned long i = 0; i < count; i++)
+    {
+        FlowMeterService::OnPulse();
+    }
+}
+
+void test_dose_by_volume_stops_at_target()
+{
+    PumpDoseService pump;
+    unsigned long targetPulses = 250 * pulsesPerLitre / 1000;
+
+    pump.Start(targetPulses, 30000);
+    TEST_ASSERT_TRUE(pump.IsByVolume());
+
+    while(!pump.IsDone())
+    {
+        simulatedMillis += 10;
+        SimulatePulses(1);
+    }
+
+    pump.Stop();
+
+    TEST_ASSERT_FALSE(pump.HasTimedOut());
+    TEST_ASSERT_EQUAL_UINT32(targetPulses * 10, pump.GetPumpMillis());
+    TEST_ASSERT_DOUBLE_WITHIN(1000 / pulsesPerLitre, 250, pump.GetMillilitres(pulsesPerLitre));
+}
+
+//Pulses keep arriving between two polls of the watering task, the dose overshoots by less than one poll's worth
+void test_dose_overshoots_by_less_than_one_poll()
+{
+    PumpDoseService pump;
+    unsigned long targetPulses = 250 * pulsesPerLitre / 1000;
+    unsigned long polls = 0;
+
+    pump.Start(targetPulses, 30000);
+
+    while(!pump.IsDone())
+    {
+        simulatedMillis += 20;
+        SimulatePulses(7);
+        polls++;
+    }
+
+    pump.Stop();
+
+    TEST_ASSERT_EQUAL_UINT32(16, polls); //112 pulses
+    TEST_ASSERT_EQUAL_UINT32(16 * 20, pump.GetPumpMillis());
+    TEST_ASSERT_DOUBLE_WITHIN(7 * 1000 / pulsesPerLitre, 250, pump.GetMillilitres(pulsesPerLitre));
+}
+
+void test_dose_by_volume_times_out_without_flow()
+{
+    PumpDoseService pump;
+
+    pump.Start(100, 30000);
+
+    simulatedMillis = 29999;
+    TEST_ASSERT_FALSE(pump.IsDone());
+
+    simulatedMillis = 30000;
+    TEST_ASSERT_TRUE(pump.IsDone());
+    pump.Stop();
+
+    TEST_ASSERT_TRUE(pump.HasTimedOut());
+    TEST_ASSERT_EQUAL_UINT32(30000, pump.GetPumpMillis());
+    TEST_ASSERT_EQUAL_DOUBLE(0, pump.GetMillilitres(pulsesPerLitre));
+}
+
+void test_dose_by_time_ignores_the_flow_meter()
+{
+    PumpDoseService pump;
+
+    simulatedMillis = 1000;
+    pump.Start(0, 3000);
+    TEST_ASSERT_FALSE(pump.IsByVolume());
+
+    SimulatePulses(10000);
+    simulatedMillis = 3999;
+    TEST_ASSERT_FALSE(pump.IsDone());
+
+    simulatedMillis = 4000;
+    TEST_ASSERT_TRUE(pump.IsDone());
+    pump.Stop();
+
+    TEST_ASSERT_FALSE(pump.HasTimedOut());
+    TEST_ASSERT_EQUAL_UINT32(3000, pump.GetPumpMillis());
+}
+
+//The hose drains through the meter after the pump stops, the volume read after the settle time includes it
+void test_volume_counts_after_stop()
+{
+    PumpDoseService pump;
+
+    pump.Start(0, 1000);
+    simulatedMillis = 1000;
+    TEST_ASSERT_TRUE(pump.IsDone());
+    pump.Stop();
+
+    SimulatePulses(45);
+
+    TEST_ASSERT_EQUAL_UINT32(1000, pump.GetPumpMillis());
+    TEST_ASSERT_DOUBLE_WITHIN(0.001, 100, pump.GetMillilitres(pulsesPerLitre));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_dose_by_volume_stops_at_target);
+    RUN_TEST(test_dose_overshoots_by_less_than_one_poll);
+    RUN_TEST(test_dose_by_volume_times_out_without_flow);
+    RUN_TEST(test_dose_by_time_ignores_the_flow_meter);
+    RUN_TEST(test_volume_counts_after_stop);
+    return UNITY_END();
+}
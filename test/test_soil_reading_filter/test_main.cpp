@@ -0,0 +1,188 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "SoilReadingFilter.h"
+
+//Sensor fault decisions and the stop criterion are taken on the robust variance, these cases are the ones a raw
+//variance gets wrong
+
+#define maxSoilReadingVariance 400
+#define minSamples 20
+#define maxSamples 1000
+#define tolerance 1.0
+
+void setUp() {}
+void tearDown() {}
+
+void AddNoisySamples(SoilReadingFilter& filter, double centre, int amplitude, int count)
+{
+    for(int i = 0; i < count; i++)
+    {
+        filter.Add(centre + (rand() % (2 * amplitude + 1)) - amplitude);
+    }
+}
+
+void test_single_spike_is_not_a_fault()
+{
+    SoilReadingFilter filter;
+    filter.Reset();
+    srand(1);
+
+    AddNoisySamples(filter, 350, 3, 100);
+    filter.Add(1023);
+    AddNoisySamples(filter, 350, 3, 99);
+
+    //The raw variance is blown up by the one spike, the group means are not
+    TEST_ASSERT_TRUE(filter.GetVariance() > maxSoilReadingVariance);
+    TEST_ASSERT_TRUE(filter.GetRobustVariance() < maxSoilReadingVariance);
+    TEST_ASSERT_DOUBLE_WITHIN(2, 350, filter.GetEstimate());
+}
+
+void test_constant_readings_have_no_spread()
+{
+    SoilReadingFilter filter;
+    filter.Reset();
+
+    for(int i = 0; i < 200; i++)
+    {
+        filter.Add(512);
+    }
+
+    TEST_ASSERT_EQUAL_DOUBLE(0, filter.GetVariance());
+    TEST_ASSERT_EQUAL_DOUBLE(0, filter.GetRobustVariance());
+    TEST_ASSERT_EQUAL_DOUBLE(512, filter.GetEstimate());
+}
+
+void test_floating_input_is_a_fault()
+{
+    SoilReadingFilter filter;
+    filter.Reset();
+    srand(2);
+
+    //A disconnected input wanders over the whole ADC range
+    for(int i = 0; i < 200; i++)
+    {
+        filter.Add(rand() % 1024);
+    }
+
+    TEST_ASSERT_TRUE(filter.GetRobustVariance() > maxSoilReadingVariance);
+}
+
+void test_few_samples_fall_back_to_variance()
+{
+    SoilReadingFilter filter;
+    filter.Reset();
+
+    filter.Add(300);
+    filter.Add(310);
+
+    TEST_ASSERT_EQUAL_DOUBLE(filter.GetVariance(), filter.GetRobustVariance());
+}
+
+//Samples one at a time like a measurement would, until the filter says it has enough
+unsigned long SampleUntilComplete(SoilReadingFilter& filter, double centre, int amplitude, int spikeAt)
+{
+    while(!filter.IsComplete(minSamples, maxSamples, tolerance))
+    {
+        filter.Add((int)filter.GetCount() == spikeAt ? 1023 : centre + (rand() % (2 * amplitude + 1)) - amplitude);
+    }
+
+    return filter.GetCount();
+}
+
+void test_quiet_signal_stops_early()
+{
+    SoilReadingFilter filter;
+    filter.Reset();
+    srand(3);
+
+    unsigned long samples = SampleUntilComplete(filter, 350, 3, -1);
+
+    TEST_ASSERT_TRUE(samples < 100);
+    TEST_ASSERT_TRUE(filter.GetError() <= tolerance);
+}
+
+void test_spike_does_not_delay_convergence()
+{
+    SoilReadingFilter filter;
+    filter.Reset();
+    srand(3);
+
+    unsigned long samples = SampleUntilComplete(filter, 350, 3, 5);
+
+    //On the raw variance the one spike alone would keep the interval wider than the tolerance up to maxSamples
+    TEST_ASSERT_TRUE(samples < 100);
+    TEST_ASSERT_TRUE(soilReadingConfidenceFactor * sqrt(filter.GetVariance() / samples) > tolerance);
+    TEST_ASSERT_DOUBLE_WITHIN(2, 350, filter.GetEstimate());
+}
+
+void test_never_stops_before_min_samples()
+{
+    SoilReadingFilter filter;
+    filter.Reset();
+
+    //A constant input has converged after two samples
+    for(int i = 0; i < minSamples - 1; i++)
+    {
+        filter.Add(512);
+        TEST_ASSERT_FALSE(filter.IsComplete(minSamples, maxSamples, tolerance));
+    }
+
+    filter.Add(512);
+    TEST_ASSERT_TRUE(filter.IsComplete(minSamples, maxSamples, tolerance));
+}
+
+void test_stops_at_max_samples()
+{
+    SoilReadingFilter filter;
+    filter.Reset();
+    srand(4);
+
+    //A floating input never gets within the tolerance
+    while(!filter.IsComplete(minSamples, maxSamples, tolerance))
+    {
+        filter.Add(rand() % 1024);
+    }
+
+    TEST_ASSERT_EQUAL(maxSamples, filter.GetCount());
+    TEST_ASSERT_TRUE(filter.GetError() > tolerance);
+}
+
+//The reported error is a 95% interval, the estimate should be within it of the true value about that often
+void test_reported_error_covers_the_true_value()
+{
+    srand(5);
+    int covered = 0;
+    int trials = 500;
+
+    for(int trial = 0; trial < trials; trial++)
+    {
+        SoilReadingFilter filter;
+        filter.Reset();
+        AddNoisySamples(filter, 350, 10, 200);
+
+        if(fabs(filter.GetEstimate() - 350) <= filter.GetError())
+        {
+            covered++;
+        }
+    }
+
+    printf("Error interval covered the true value in %d of %d measurements\n", covered, trials);
+    TEST_ASSERT_TRUE(covered >= trials * 92 / 100);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_single_spike_is_not_a_fault);
+    RUN_TEST(test_constant_readings_have_no_spread);
+    RUN_TEST(test_floating_input_is_a_fault);
+    RUN_TEST(test_few_samples_fall_back_to_variance);
+    RUN_TEST(test_quiet_signal_stops_early);
+    RUN_TEST(test_spike_does_not_delay_convergence);
+    RUN_TEST(test_never_stops_before_min_samples);
+    RUN_TEST(test_stops_at_max_samples);
+    RUN_TEST(test_reported_error_covers_the_true_value);
+    return UNITY_END();
+}
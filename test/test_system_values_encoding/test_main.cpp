@@ -0,0 +1,176 @@
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <ArduinoJson.h>
+#include "SystemValueFields.h"
+
+//Host benchmark of the /get-watering-system-values encodings: long or short keys, JSON or MessagePack.
+//The fields and the capacity are the ones main.cpp serves, each filled with a typical value of its kind.
+//On the device the encode time scales with the same ratios, the absolute numbers here are x86-64.
+
+#define encodeRepetitions 2000
+
+struct BenchmarkField
+{
+    const char* key;
+    const char* shortKey;
+    SystemValueKind kind;
+};
+
+#define BENCHMARK_FIELD(key, shortKey, kind, read) { key, shortKey, kind },
+
+const BenchmarkField benchmarkFields[] =
+{
+    SYSTEM_VALUE_FIELDS(BENCHMARK_FIELD)
+};
+
+size_t GetCapacity(bool compact)
+{
+    return GetSystemValuesCapacity(numberOfSystemValueFields, compact ? 0 : numberOfSystemValueDurations);
+}
+
+void FillDocument(JsonDocument& doc, bool compact)
+{
+    for(const BenchmarkField& field : benchmarkFields)
+    {
+        JsonVariant value = doc.getOrAddMember(compact ? field.shortKey : field.key);
+
+        switch(field.kind)
+        {
+            case IntegerValue: value.set(12345); break;
+            case RealValue: value.set(351.27); break;
+            case BoolValue: value.set(true); break;
+            case TextValue: value.set("threshold"); break;
+            case DurationValue:
+                if(compact)
+                {
+                    value.set(12.0);
+                }
+                else
+                {
+                    value.set(std::string("12.00")); //copied into the pool like the String of main.cpp
+                }
+                break;
+        }
+    }
+}
+
+struct EncodeResult
+{
+    size_t bytes;
+    double micros;
+};
+
+EncodeResult Encode(bool compact, bool msgPack)
+{
+    static char output[4096];
+    EncodeResult result = { 0, 0 };
+    auto start = std::chrono::steady_clock::now();
+
+    for(int i = 0; i < encodeRepetitions; i++)
+    {
+        DynamicJsonDocument doc(GetCapacity(compact));
+        FillDocument(doc, compact);
+        TEST_ASSERT_FALSE(doc.overflowed());
+
+        result.bytes = msgPack ? serializeMsgPack(doc, output, sizeof(output)) : serializeJson(doc, output, sizeof(output));
+    }
+
+    result.micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / encodeRepetitions;
+
+    return result;
+}
+
+void PrintResult(const char* name, const EncodeResult& result)
+{
+    char line[120];
+    snprintf(line, sizeof(line), "%-22s %5zu bytes %6.1f us (%zu fields)", name, result.bytes, result.micros, numberOfSystemValueFields);
+    TEST_MESSAGE(line);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_capacity_fits_every_field()
+{
+    for(int compact = 0; compact < 2; compact++)
+    {
+        DynamicJsonDocument doc(GetCapacity(compact));
+        FillDocument(doc, compact);
+
+        TEST_ASSERT_FALSE(doc.overflowed());
+        TEST_ASSERT_EQUAL_UINT32(numberOfSystemValueFields, doc.size());
+    }
+}
+
+//Distinct strings of the longest length, so the document can not share one copy between them
+void test_capacity_fits_the_longest_durations()
+{
+    DynamicJsonDocument doc(GetCapacity(false));
+    std::string longest(systemValueMaxStringLength, '0');
+    char index = 'a';
+
+    for(const BenchmarkField& field : benchmarkFields)
+    {
+        JsonVariant value = doc.getOrAddMember(field.key);
+
+        if(field.kind == DurationValue)
+        {
+            longest[0] = index++;
+            value.set(longest);
+        }
+        else
+        {
+            value.set(12345);
+        }
+    }
+
+    TEST_ASSERT_FALSE(doc.overflowed());
+    TEST_ASSERT_EQUAL_UINT32(numberOfSystemValueFields, doc.size());
+}
+
+void test_capacity_fits_fields_picked_by_name()
+{
+    const char* picked[] = { "MinutesUntilNextSoilReading", "MinutesAgoSinceLastSoilReading", "HoursAgoLastWateringCycleWasDone" };
+    DynamicJsonDocument doc(GetSystemValuesCapacity(3, 3));
+    std::string longest(systemValueMaxStringLength, '0');
+    char index = 'a';
+
+    for(const char* key : picked)
+    {
+        longest[0] = index++;
+        doc.getOrAddMember(key).set(longest);
+    }
+
+    TEST_ASSERT_FALSE(doc.overflowed());
+    TEST_ASSERT_EQUAL_UINT32(3, doc.size());
+}
+
+void test_encodings()
+{
+    EncodeResult jsonLong = Encode(false, false);
+    EncodeResult jsonShort = Encode(true, false);
+    EncodeResult msgPackLong = Encode(false, true);
+    EncodeResult msgPackShort = Encode(true, true);
+
+    PrintResult("JSON, long keys", jsonLong);
+    PrintResult("JSON, short keys", jsonShort);
+    PrintResult("MessagePack, long keys", msgPackLong);
+    PrintResult("MessagePack, short keys", msgPackShort);
+
+    //The sizes are deterministic, the times are only printed
+    TEST_ASSERT_TRUE(jsonShort.bytes < jsonLong.bytes / 2);
+    TEST_ASSERT_TRUE(msgPackShort.bytes < jsonShort.bytes);
+    TEST_ASSERT_TRUE(msgPackLong.bytes < jsonLong.bytes);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_capacity_fits_every_field);
+    RUN_TEST(test_capacity_fits_the_longest_durations);
+    RUN_TEST(test_capacity_fits_fields_picked_by_name);
+    RUN_TEST(test_encodings);
+    return UNITY_END();
+}
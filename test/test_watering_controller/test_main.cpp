@@ -0,0 +1,166 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "WateringController.h"
+
+//Host benchmark of threshold control against the PID mode on a simulated pot. The pot dries faster by day than by night,
+//a watering soaks in over soakMinutes and every reading carries noise, readings are soilReadingFrequencyMinutes apart.
+//Both modes use the zone defaults of main.cpp: drynessAllowed 350, 3 s per watering, kp 0.02, ki 0.0005, kd 0.
+
+#define setpoint 350.0
+#define bandHalfWidth 15.0 //readings within setpoint +/- this count as on target
+#define wateringSeconds 3.0
+#define responsePerPumpSecond 12.0 //soil reading drop per pump second once soaked in
+#define soakMinutes 20
+#define soilReadingFrequencyMinutes 45
+#define simulatedDays 14
+#define readingNoise 3
+
+const WateringControllerGains defaultGains = { 0.02, 0.0005, 0 };
+
+struct BenchmarkResult
+{
+    double pumpSeconds;
+    int waterings;
+    double minutesOutsideBand;
+    double maxReading;
+};
+
+enum ControlMode
+{
+    Threshold,
+    Pid
+};
+
+BenchmarkResult Simulate(ControlMode mode, const WateringControllerGains& gains)
+{
+    WateringController controller;
+    BenchmarkResult result = { 0, 0, 0, 0 };
+    double reading = setpoint - 20;
+    double soakingPerMinute = 0;
+    int soakMinutesLeft = 0;
+
+    srand(4);
+
+    for(unsigned long minute = 0; minute < simulatedDays * 24 * 60UL; minute++)
+    {
+        double hourOfDay = fmod(minute / 60.0, 24);
+        reading += 0.4 + 0.3 * sin((hourOfDay - 8) * M_PI / 12);
+
+        if(soakMinutesLeft > 0)
+        {
+            reading -= soakingPerMinute;
+            soakMinutesLeft--;
+        }
+
+        if(fabs(reading - setpoint) > bandHalfWidth)
+        {
+            result.minutesOutsideBand++;
+        }
+
+        result.maxReading = fmax(result.maxReading, reading);
+
+        if(minute % soilReadingFrequencyMinutes != 0)
+        {
+            continue;
+        }
+
+        double measured = reading + (rand() % (2 * readingNoise + 1)) - readingNoise;
+        double doseFraction = 0;
+
+        if(mode == Threshold)
+        {
+            doseFraction = measured > setpoint ? 1.0 : 0;
+        }
+        else
+        {
+            doseFraction = controller.Compute(measured, setpoint, minute * 60000UL, gains);
+            doseFraction = doseFraction < minDoseFraction ? 0 : doseFraction;
+        }
+
+        if(doseFraction > 0)
+        {
+            double pumpSeconds = doseFraction * wateringSeconds;
+
+            result.pumpSeconds += pumpSeconds;
+            result.waterings++;
+            soakingPerMinute = pumpSeconds * responsePerPumpSecond / soakMinutes;
+            soakMinutesLeft = soakMinutes;
+        }
+    }
+
+    return result;
+}
+
+void PrintResult(const char* name, const BenchmarkResult& result)
+{
+    char line[160];
+    double totalMinutes = simulatedDays * 24 * 60.0;
+
+    snprintf(line, sizeof(line), "%s: %.0f pump s in %d waterings, %.1f%% of the time outside %g +/- %g, max reading %.0f",
+        name, result.pumpSeconds, result.waterings, 100 * result.minutesOutsideBand / totalMinutes, setpoint, bandHalfWidth, result.maxReading);
+    TEST_MESSAGE(line);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_output_is_clamped()
+{
+    WateringController controller;
+
+    TEST_ASSERT_EQUAL_DOUBLE(0, controller.Compute(setpoint - 50, setpoint, 0, defaultGains));
+    controller.Reset();
+    TEST_ASSERT_EQUAL_DOUBLE(maxDoseFraction, controller.Compute(setpoint + 500, setpoint, 0, defaultGains));
+}
+
+//A reading stuck far above the setpoint saturates the output, the integral must not keep growing meanwhile
+void test_integral_does_not_wind_up_while_saturated()
+{
+    WateringController controller;
+
+    for(unsigned long minute = 0; minute <= 24 * 60; minute += soilReadingFrequencyMinutes)
+    {
+        controller.Compute(setpoint + 200, setpoint, minute * 60000UL, defaultGains);
+    }
+
+    TEST_ASSERT_EQUAL_DOUBLE(0, controller.GetIntegral());
+
+    //Back at the setpoint the dose drops at once instead of unwinding a day of integral
+    TEST_ASSERT_TRUE(controller.Compute(setpoint, setpoint, 25 * 60 * 60000UL, defaultGains) < minDoseFraction);
+}
+
+void test_derivative_ignores_setpoint_changes()
+{
+    WateringController controller;
+    WateringControllerGains gains = { 0, 0, 1 };
+
+    controller.Compute(340, setpoint, 0, gains);
+    TEST_ASSERT_EQUAL_DOUBLE(0, controller.Compute(340, setpoint - 30, 45 * 60000UL, gains));
+}
+
+void test_benchmark_against_threshold()
+{
+    BenchmarkResult threshold = Simulate(Threshold, defaultGains);
+    BenchmarkResult pid = Simulate(Pid, defaultGains);
+
+    PrintResult("threshold", threshold);
+    PrintResult("pid", pid);
+
+    TEST_ASSERT_TRUE(pid.minutesOutsideBand <= threshold.minutesOutsideBand);
+    TEST_ASSERT_TRUE(pid.maxReading <= threshold.maxReading);
+
+    //The pot loses the same water either way, control only changes when it is given back
+    TEST_ASSERT_DOUBLE_WITHIN(0.05 * threshold.pumpSeconds, threshold.pumpSeconds, pid.pumpSeconds);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_output_is_clamped);
+    RUN_TEST(test_integral_does_not_wind_up_while_saturated);
+    RUN_TEST(test_derivative_ignores_setpoint_changes);
+    RUN_TEST(test_benchmark_against_threshold);
+    return UNITY_END();
+}
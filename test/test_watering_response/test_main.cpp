@@ -0,0 +1,157 @@
+#include <unity.h>
+#include <stdlib.h>
+#include "WateringResponseEstimator.h"
+
+//Simulated pot: each watering lowers the reading by a fixed amount per pump second while the reservoir has water,
+//between cycles the soil dries and every reading carries some noise. The estimator has to flag an empty reservoir
+//after exactly noEffectCyclesBeforeEmpty dry cycles and never while the reservoir still has water.
+
+#define pumpSeconds 3.0
+#define wetResponsePerPumpSecond 12.0
+#define dryingPerCycle 30.0
+#define readingNoise 4
+
+struct SimulatedPot
+{
+    double reading = 420;
+    int reservoirCycles = 0; //waterings left in the reservoir
+
+    double Read()
+    {
+        return reading + (rand() % (2 * readingNoise + 1)) - readingNoise;
+    }
+
+    bool Water()
+    {
+        if(reservoirCycles == 0)
+        {
+            return false;
+        }
+
+        reservoirCycles--;
+        reading -= wetResponsePerPumpSecond * pumpSeconds;
+        return true;
+    }
+};
+
+//One cycle as the zone runs it: reading before, watering, the delayed reading that judges it, then drying
+void RunCycle(WateringResponseEstimator& estimator, SimulatedPot& pot, bool flowMeterFitted)
+{
+    double readingBefore = pot.Read();
+    bool pumped = pot.Water();
+
+    estimator.RecordWatering(readingBefore, pumpSeconds, !flowMeterFitted || pumped);
+    TEST_ASSERT_TRUE(estimator.IsResponsePending());
+
+    estimator.RecordReading(pot.Read());
+    TEST_ASSERT_FALSE(estimator.IsResponsePending());
+
+    pot.reading += dryingPerCycle;
+}
+
+void setUp()
+{
+    srand(3);
+}
+
+void tearDown() {}
+
+void test_no_false_alarm_while_reservoir_has_water()
+{
+    WateringResponseEstimator estimator;
+    SimulatedPot pot;
+    pot.reservoirCycles = 50;
+
+    for(int cycle = 0; cycle < 50; cycle++)
+    {
+        RunCycle(estimator, pot, false);
+        TEST_ASSERT_FALSE(estimator.IsReservoirEmpty());
+    }
+
+    TEST_ASSERT_DOUBLE_WITHIN(readingNoise, wetResponsePerPumpSecond, estimator.GetUsualResponsePerPumpSecond());
+}
+
+void test_empty_after_k_cycles_without_flow_meter()
+{
+    WateringResponseEstimator estimator;
+    SimulatedPot pot;
+    pot.reservoirCycles = 5;
+
+    for(int cycle = 0; cycle < 5; cycle++)
+    {
+        RunCycle(estimator, pot, false);
+    }
+
+    for(int cycle = 1; cycle < noEffectCyclesBeforeEmpty; cycle++)
+    {
+        RunCycle(estimator, pot, false);
+        TEST_ASSERT_FALSE(estimator.IsReservoirEmpty());
+    }
+
+    RunCycle(estimator, pot, false);
+    TEST_ASSERT_TRUE(estimator.IsReservoirEmpty());
+    TEST_ASSERT_EQUAL_UINT8(noEffectCyclesBeforeEmpty, estimator.GetNoEffectCycles());
+}
+
+void test_missing_flow_counts_as_no_effect()
+{
+    WateringResponseEstimator estimator;
+    SimulatedPot pot;
+
+    for(int cycle = 0; cycle < noEffectCyclesBeforeEmpty; cycle++)
+    {
+        RunCycle(estimator, pot, true);
+    }
+
+    TEST_ASSERT_TRUE(estimator.IsReservoirEmpty());
+}
+
+void test_refill_clears_empty()
+{
+    WateringResponseEstimator estimator;
+    SimulatedPot pot;
+
+    for(int cycle = 0; cycle < noEffectCyclesBeforeEmpty + 3; cycle++)
+    {
+        RunCycle(estimator, pot, false);
+    }
+
+    TEST_ASSERT_TRUE(estimator.IsReservoirEmpty());
+
+    pot.reservoirCycles = 10;
+    RunCycle(estimator, pot, false);
+    TEST_ASSERT_FALSE(estimator.IsReservoirEmpty());
+    TEST_ASSERT_EQUAL_UINT8(0, estimator.GetNoEffectCycles());
+}
+
+//The same pot read a whole interval later has dried by more than the watering wetted it, which is why
+//the judging reading is taken responseReadingDelayMillis after the watering and not at the next regular reading
+void test_late_reading_hides_the_response()
+{
+    WateringResponseEstimator estimator;
+    SimulatedPot pot;
+    pot.reservoirCycles = 10;
+
+    for(int cycle = 0; cycle < noEffectCyclesBeforeEmpty; cycle++)
+    {
+        double readingBefore = pot.Read();
+        pot.Water();
+        pot.reading += 2 * dryingPerCycle;
+
+        estimator.RecordWatering(readingBefore, pumpSeconds, true);
+        estimator.RecordReading(pot.Read());
+    }
+
+    TEST_ASSERT_TRUE(estimator.IsReservoirEmpty());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_no_false_alarm_while_reservoir_has_water);
+    RUN_TEST(test_empty_after_k_cycles_without_flow_meter);
+    RUN_TEST(test_missing_flow_counts_as_no_effect);
+    RUN_TEST(test_refill_clears_empty);
+    RUN_TEST(test_late_reading_hides_the_response);
+    return UNITY_END();
+}
@@ -0,0 +1,290 @@
+#include <unity.h>
+#include "ZoneControlService.h"
+
+//Runs the zone flows of ZoneControlService the way the scheduler does, a tick every 20 ms on a simulated clock.
+//The pumps are OutputPins, off target their levels are in MockGpio.
+
+#define tickMillis 20
+#define pump0Gpio 13
+#define pump1Gpio 12
+
+unsigned long simulatedMillis = 0;
+
+unsigned long SimulatedClock()
+{
+    return simulatedMillis;
+}
+
+Zone zones[numberOfZones];
+constexpr DigitalOutput zoneWaterPumps[numberOfZones] = { MakeDigitalOutput<pump0Gpio>(), MakeDigitalOutput<pump1Gpio>() };
+ZoneControlService zoneControlService;
+ZoneControlSettings settings;
+int wateredZones[8];
+int waterings = 0;
+
+void OnZoneWatered(uint8_t zone)
+{
+    wateredZones[waterings++] = zone;
+}
+
+void setUp()
+{
+    simulatedMillis = 0;
+    Coroutine::clock = SimulatedClock;
+
+    for(uint8_t zone = 0; zone < numberOfZones; zone++)
+    {
+        zones[zone] = Zone();
+    }
+
+    MockGpio::levels[pump0Gpio] = LOW;
+    MockGpio::levels[pump1Gpio] = LOW;
+    waterings = 0;
+
+    zoneControlService = ZoneControlService();
+    zoneControlService.Begin(zones, zoneWaterPumps, OnZoneWatered);
+
+    settings.wateringAutomationEnabled = true;
+    settings.wateringControlMode = ThresholdControl;
+    settings.controllerGains = { 0.02, 0.0005, 0 };
+    settings.stuckSoilReadingsBeforeFault = 4;
+    settings.maxSoilReadingVariance = 400;
+    settings.adaptiveSoilReadingEnabled = true;
+    settings.minSoilReadingIntervalMinutes = 5;
+    settings.maxSoilReadingIntervalMinutes = 120;
+    settings.flowMeterPulsesPerLitre = 450;
+    settings.maxWateringSeconds = 30;
+    settings.reservoirEmptyProbeSeconds = 1;
+    settings.pumpSettleMillis = 1000;
+}
+
+void tearDown() {}
+
+SoilReading MakeReading(double average, double variance)
+{
+    SoilReading reading = { average, variance, variance, 1, 100, 5000, 220 };
+
+    return reading;
+}
+
+//The measurement task stamps the zone when it starts measuring, the reading comes in right after
+void Measure(uint8_t zone, double average, double variance)
+{
+    zones[zone].lastSoilReadingMillis = simulatedMillis;
+    zoneControlService.EvaluateSoilReading(zone, MakeReading(average, variance), settings);
+}
+
+//Ticks the watering task until the given number of waterings have finished, false if that takes over a minute
+bool RunWateringUntil(int expectedWaterings)
+{
+    for(unsigned long tick = 0; tick < 60000 / tickMillis; tick++)
+    {
+        zoneControlService.RunScheduledWatering(settings);
+
+        TEST_ASSERT_FALSE(MockGpio::levels[pump0Gpio] == HIGH && MockGpio::levels[pump1Gpio] == HIGH);
+
+        if(waterings == expectedWaterings)
+        {
+            return true;
+        }
+
+        simulatedMillis += tickMillis;
+    }
+
+    return false;
+}
+
+void test_dry_reading_queues_a_full_dose()
+{
+    Measure(0, 400, 4);
+
+    TEST_ASSERT_FALSE(zones[0].soilSensorFault);
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, zones[0].pendingDoseFraction);
+    TEST_ASSERT_EQUAL_INT(0, zoneControlService.GetPendingWateringZone());
+}
+
+void test_wet_reading_queues_nothing()
+{
+    Measure(0, 300, 4);
+
+    TEST_ASSERT_EQUAL_DOUBLE(0, zones[0].pendingDoseFraction);
+    TEST_ASSERT_EQUAL_INT(-1, zoneControlService.GetPendingWateringZone());
+}
+
+void test_faulty_reading_is_never_watered_on()
+{
+    Measure(0, 900, 5000);
+
+    TEST_ASSERT_TRUE(zones[0].soilSensorFault);
+    TEST_ASSERT_EQUAL_DOUBLE(0, zones[0].pendingDoseFraction);
+}
+
+void test_stuck_sensor_is_a_fault_after_unchanged_readings()
+{
+    //The first reading has nothing to compare with
+    for(uint8_t i = 0; i < settings.stuckSoilReadingsBeforeFault; i++)
+    {
+        Measure(0, 300, 0);
+        TEST_ASSERT_FALSE(zones[0].soilSensorFault);
+    }
+
+    Measure(0, 300, 0);
+    TEST_ASSERT_TRUE(zones[0].soilSensorFault);
+
+    //One changed reading clears it
+    Measure(0, 301, 0);
+    TEST_ASSERT_FALSE(zones[0].soilSensorFault);
+}
+
+void test_watering_cycle_runs_the_pump_for_the_dose()
+{
+    zones[0].wateringTimeSeconds = 3;
+    Measure(0, 400, 4);
+
+    zoneControlService.RunScheduledWatering(settings);
+    TEST_ASSERT_EQUAL_UINT8(HIGH, MockGpio::levels[pump0Gpio]);
+    TEST_ASSERT_TRUE(zoneControlService.IsWateringInProgress());
+
+    simulatedMillis = 2999;
+    zoneControlService.RunScheduledWatering(settings);
+    TEST_ASSERT_EQUAL_UINT8(HIGH, MockGpio::levels[pump0Gpio]);
+
+    simulatedMillis = 3000;
+    zoneControlService.RunScheduledWatering(settings);
+    TEST_ASSERT_EQUAL_UINT8(LOW, MockGpio::levels[pump0Gpio]);
+
+    //Finished once the hose has drained
+    simulatedMillis = 3000 + settings.pumpSettleMillis - 1;
+    zoneControlService.RunScheduledWatering(settings);
+    TEST_ASSERT_EQUAL_INT(0, waterings);
+
+    simulatedMillis = 3000 + settings.pumpSettleMillis;
+    zoneControlService.RunScheduledWatering(settings);
+    TEST_ASSERT_EQUAL_INT(1, waterings);
+
+    TEST_ASSERT_FALSE(zoneControlService.IsWateringInProgress());
+    TEST_ASSERT_FALSE(zoneControlService.IsWateringCycleStarted());
+    TEST_ASSERT_EQUAL_DOUBLE(0, zones[0].pendingDoseFraction);
+    TEST_ASSERT_EQUAL_UINT32(3000 + settings.pumpSettleMillis, zones[0].lastWateringMillis);
+    TEST_ASSERT_TRUE(zones[0].wateringResponse.IsResponsePending());
+}
+
+void test_pending_zones_are_watered_in_turn()
+{
+    Measure(1, 400, 4);
+    Measure(0, 400, 4);
+
+    TEST_ASSERT_TRUE(RunWateringUntil(2));
+    TEST_ASSERT_EQUAL_INT(0, wateredZones[0]);
+    TEST_ASSERT_EQUAL_INT(1, wateredZones[1]);
+    TEST_ASSERT_EQUAL_INT(-1, zoneControlService.GetPendingWateringZone());
+}
+
+void test_empty_reservoir_only_probes()
+{
+    zones[0].wateringTimeSeconds = 3;
+
+    //Waterings that do not move the reading, the reservoir is empty after noEffectCyclesBeforeEmpty of them
+    for(int cycle = 0; cycle < noEffectCyclesBeforeEmpty; cycle++)
+    {
+        Measure(0, 400, 4);
+        TEST_ASSERT_TRUE(RunWateringUntil(cycle + 1));
+        simulatedMillis += responseReadingDelayMillis;
+    }
+
+    Measure(0, 400, 4);
+    TEST_ASSERT_TRUE(zones[0].wateringResponse.IsReservoirEmpty());
+    TEST_ASSERT_TRUE(zones[0].notificationPending);
+
+    unsigned long startMillis = simulatedMillis;
+    TEST_ASSERT_TRUE(RunWateringUntil(noEffectCyclesBeforeEmpty + 1));
+    TEST_ASSERT_TRUE(simulatedMillis - startMillis <= settings.reservoirEmptyProbeSeconds * 1000UL + settings.pumpSettleMillis + tickMillis);
+}
+
+void test_response_reading_is_due_after_the_delay()
+{
+    Measure(0, 400, 4);
+    TEST_ASSERT_TRUE(RunWateringUntil(1));
+    unsigned long wateredMillis = zones[0].lastWateringMillis;
+
+    TEST_ASSERT_EQUAL_UINT32(responseReadingDelayMillis, zoneControlService.GetMillisUntilNextSoilReading(0, wateredMillis, settings));
+
+    simulatedMillis = wateredMillis + responseReadingDelayMillis - 1;
+    TEST_ASSERT_EQUAL_INT(-1, zoneControlService.GetNextDueZone(simulatedMillis, settings));
+
+    simulatedMillis = wateredMillis + responseReadingDelayMillis;
+    TEST_ASSERT_EQUAL_INT(0, zoneControlService.GetNextDueZone(simulatedMillis, settings));
+}
+
+//The reading that should judge a watering is a sensor fault and was taken after the response delay. The zone has to
+//go back to its normal interval, not stay due forever or wait for a clock wrap
+void test_fault_reading_after_watering()
+{
+    zones[0].soilReadingFrequencyMinutes = 45;
+    Measure(0, 400, 4);
+    TEST_ASSERT_TRUE(RunWateringUntil(1));
+
+    simulatedMillis += responseReadingDelayMillis + 60000;
+    TEST_ASSERT_EQUAL_INT(0, zoneControlService.GetNextDueZone(simulatedMillis, settings));
+
+    Measure(0, 900, 5000);
+
+    TEST_ASSERT_TRUE(zones[0].soilSensorFault);
+    TEST_ASSERT_FALSE(zones[0].wateringResponse.IsResponsePending());
+    TEST_ASSERT_EQUAL_UINT32(45 * 60000UL, zoneControlService.GetMillisUntilNextSoilReading(0, simulatedMillis, settings));
+    TEST_ASSERT_EQUAL_INT(-1, zoneControlService.GetNextDueZone(simulatedMillis, settings));
+
+    //Measured and watered again once the sensor is back
+    simulatedMillis += 45 * 60000UL;
+    TEST_ASSERT_EQUAL_UINT32(0, zoneControlService.GetMillisUntilNextSoilReading(0, simulatedMillis, settings));
+
+    Measure(0, 400, 4);
+    TEST_ASSERT_FALSE(zones[0].soilSensorFault);
+    TEST_ASSERT_TRUE(RunWateringUntil(2));
+}
+
+//A response reading that is late, e.g. automation was off, is due right away and never underflows
+void test_late_response_reading_is_due()
+{
+    Measure(0, 400, 4);
+    TEST_ASSERT_TRUE(RunWateringUntil(1));
+
+    zones[0].lastSoilReadingMillis = zones[0].lastWateringMillis + 2 * responseReadingDelayMillis;
+    simulatedMillis = zones[0].lastSoilReadingMillis + 1000;
+
+    TEST_ASSERT_EQUAL_UINT32(0, zoneControlService.GetMillisUntilNextSoilReading(0, simulatedMillis, settings));
+    TEST_ASSERT_EQUAL_INT(0, zoneControlService.GetNextDueZone(simulatedMillis, settings));
+}
+
+void test_most_overdue_zone_is_measured_first()
+{
+    zones[0].soilReadingFrequencyMinutes = 45;
+    zones[1].soilReadingFrequencyMinutes = 10;
+    simulatedMillis = 50 * 60000UL;
+
+    TEST_ASSERT_EQUAL_INT(1, zoneControlService.GetNextDueZone(simulatedMillis, settings));
+
+    zones[1].lastSoilReadingMillis = simulatedMillis;
+    TEST_ASSERT_EQUAL_INT(0, zoneControlService.GetNextDueZone(simulatedMillis, settings));
+
+    zones[0].lastSoilReadingMillis = simulatedMillis;
+    TEST_ASSERT_EQUAL_INT(-1, zoneControlService.GetNextDueZone(simulatedMillis, settings));
+    TEST_ASSERT_EQUAL_UINT32(10 * 60000UL, zoneControlService.GetMillisUntilNextSoilReading(1, simulatedMillis, settings));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_dry_reading_queues_a_full_dose);
+    RUN_TEST(test_wet_reading_queues_nothing);
+    RUN_TEST(test_faulty_reading_is_never_watered_on);
+    RUN_TEST(test_stuck_sensor_is_a_fault_after_unchanged_readings);
+    RUN_TEST(test_watering_cycle_runs_the_pump_for_the_dose);
+    RUN_TEST(test_pending_zones_are_watered_in_turn);
+    RUN_TEST(test_empty_reservoir_only_probes);
+    RUN_TEST(test_response_reading_is_due_after_the_delay);
+    RUN_TEST(test_fault_reading_after_watering);
+    RUN_TEST(test_late_response_reading_is_due);
+    RUN_TEST(test_most_overdue_zone_is_measured_first);
+    return UNITY_END();
+}
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""Load generator for the REST API, to see how the single handleClient() loop copes with concurrent pollers.
+
+Each worker thread sends requests picked from the route mix and reports throughput, latency percentiles per
+route and the share of errors. 429 (rate limited) and 503 (pump busy) are counted per status, connection
+failures and timeouts as errors. Workers keep their connection open unless --no-keep-alive is given.
+
+    python3 tools/http_load_test.py esp8266.local                                 # 4 pollers for 30 s
+    python3 tools/http_load_test.py 192.168.1.50 --concurrency 8 --duration 60 --mix values=8,reading=1,put=1
+
+The default PUT sets the soil reading tolerance to its default of 1.0, pass --put-path to load another setter.
+"""
+import argparse
+import http.client
+import random
+import threading
+import time
+
+ROUTES = {
+    "values": ("GET", "/get-watering-system-values"),
+    "fields": ("GET", "/get-watering-system-values?fields=LastSoilReadingAverageValue"),
+    "reading": ("GET", "/get-current-soil-reading"),
+    "health": ("GET", "/health-check"),
+    "put": ("PUT", None),
+}
+
+
+def parse_mix(text):
+    mix = {}
+
+    for part in text.split(","):
+        name, _, weight = part.partition("=")
+
+        if name not in ROUTES:
+            raise argparse.ArgumentTypeError(f"unknown route {name}, expected one of {', '.join(ROUTES)}")
+
+        mix[name] = int(weight or 1)
+
+    return mix
+
+
+def percentile(sorted_values, fraction):
+    if not sorted_values:
+        return 0.0
+
+    return sorted_values[min(len(sorted_values) - 1, int(fraction * len(sorted_values)))]
+
+
+class Results:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.latencies = {}
+        self.statuses = {}
+        self.errors = {}
+        self.connections = 0
+
+    def record(self, route, status, latency):
+        with self.lock:
+            self.latencies.setdefault(route, []).append(latency)
+            key = (route, status)
+            self.statuses[key] = self.statuses.get(key, 0) + 1
+
+    def record_error(self, route, error):
+        with self.lock:
+            key = (route, type(error).__name__)
+            self.errors[key] = self.errors.get(key, 0) + 1
+
+    def count_connection(self):
+        with self.lock:
+            self.connections += 1
+
+
+def worker(args, routes, weights, results, stop_at):
+    connection = None
+
+    while time.monotonic() < stop_at:
+        route = random.choices(routes, weights)[0]
+        method, path = ROUTES[route]
+        path = path or args.put_path
+
+        if connection is None:
+            connection = http.client.HTTPConnection(args.host, args.port, timeout=args.timeout)
+            results.count_connection()
+
+        started = time.monotonic()
+
+        try:
+            connection.request(method, path, headers={} if args.keep_alive else {"Connection": "close"})
+            response = connection.getresponse()
+            response.read()
+            results.record(route, response.status, time.monotonic() - started)
+
+            if not args.keep_alive or response.will_close:
+                connection.close()
+                connection = None
+        except (OSError, http.client.HTTPException) as error:
+            results.record_error(route, error)
+            connection.close()
+            connection = None
+            time.sleep(0.1)  # an unreachable device is not hammered with reconnects
+
+        if args.think_time:
+            time.sleep(args.think_time)
+
+    if connection is not None:
+        connection.close()
+
+
+def report(results, elapsed):
+    total = sum(results.statuses.values())
+    errors = sum(results.errors.values())
+    print(f"{total} responses, {errors} errors in {elapsed:.1f} s: {total / elapsed:.1f} requests/s, "
+          f"{results.connections} connections")
+    print(f"{'route':<10}{'count':>8}{'p50 ms':>10}{'p90 ms':>10}{'p99 ms':>10}{'max ms':>10}  statuses")
+
+    for route, latencies in sorted(results.latencies.items()):
+        latencies.sort()
+        statuses = " ".join(f"{status}:{count}" for (name, status), count in sorted(results.statuses.items())
+                            if name == route)
+        print(f"{route:<10}{len(latencies):>8}"
+              f"{percentile(latencies, 0.50) * 1000:>10.1f}{percentile(latencies, 0.90) * 1000:>10.1f}"
+              f"{percentile(latencies, 0.99) * 1000:>10.1f}{latencies[-1] * 1000:>10.1f}  {statuses}")
+
+    for (route, error), count in sorted(results.errors.items()):
+        print(f"{route:<10}{count:>8} x {error}")
+
+    if total + errors:
+        failed = errors + sum(count for (_, status), count in results.statuses.items() if status >= 400)
+        print(f"error rate {100 * failed / (total + errors):.1f}% (connection errors and 4xx/5xx responses)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--concurrency", type=int, default=4, help="parallel pollers")
+    parser.add_argument("--duration", type=float, default=30, help="seconds to run")
+    parser.add_argument("--mix", type=parse_mix, default=parse_mix("values=8,reading=1,put=1"),
+                        help=f"route=weight list out of {', '.join(ROUTES)}")
+    parser.add_argument("--put-path", default="/set-soil-reading-tolerance?soilReadingTolerance=1")
+    parser.add_argument("--think-time", type=float, default=0, help="seconds each poller waits between requests")
+    parser.add_argument("--timeout", type=float, default=10)
+    parser.add_argument("--no-keep-alive", dest="keep_alive", action="store_false",
+                        help="open a new connection for every request")
+    args = parser.parse_args()
+
+    routes = list(args.mix)
+    weights = [args.mix[route] for route in routes]
+    results = Results()
+    started = time.monotonic()
+    stop_at = started + args.duration
+
+    threads = [threading.Thread(target=worker, args=(args, routes, weights, results, stop_at), daemon=True)
+               for _ in range(args.concurrency)]
+
+    for thread in threads:
+        thread.start()
+
+    for thread in threads:
+        thread.join()
+
+    report(results, time.monotonic() - started)
+
+
+if __name__ == "__main__":
+    main()
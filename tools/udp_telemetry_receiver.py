@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+"""Reference receiver for the UDP telemetry datagrams, see TelemetryDatagram in src/UdpTelemetryService.h.
+
+Prints every datagram and counts lost ones from gaps in the sequence numbers.
+
+    python3 tools/udp_telemetry_receiver.py                      # default multicast group
+    python3 tools/udp_telemetry_receiver.py --group '' --port 5757  # unicast to this host
+"""
+import argparse
+import socket
+import struct
+
+# magic, version, event, sequence, clockMillis, zone, flags, reading/10, variance/10, drynessAllowed, ml, dose/1000
+DATAGRAM = struct.Struct("<2sBBIIBBHHHHH")
+EVENTS = {1: "measurement", 2: "watering"}
+FLAGS = ((0x01, "sensor-fault"), (0x02, "reservoir-empty"), (0x04, "watering-timed-out"), (0x08, "automation"))
+
+
+def open_socket(group, port):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind(("", port))
+
+    if group:
+        membership = struct.pack("4s4s", socket.inet_aton(group), socket.inet_aton("0.0.0.0"))
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, membership)
+
+    return sock
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--group", default="239.255.87.1", help="multicast group to join, empty for unicast")
+    parser.add_argument("--port", type=int, default=5757)
+    args = parser.parse_args()
+
+    sock = open_socket(args.group, args.port)
+    next_sequence = {}
+    received = {}
+    lost = {}
+
+    while True:
+        data, (sender, _) = sock.recvfrom(1500)
+
+        if len(data) < DATAGRAM.size or data[:2] != b"SW":
+            print(f"{sender}: ignored {len(data)} byte datagram")
+            continue
+
+        magic, version, event, sequence, clock_millis, zone, flags, reading, variance, dryness, millilitres, dose = DATAGRAM.unpack_from(data)
+
+        expected = next_sequence.get(sender)
+
+        if expected is not None and sequence > expected:
+            lost[sender] = lost.get(sender, 0) + sequence - expected
+        elif expected is not None and sequence < expected:
+            print(f"{sender}: sequence restarted at {sequence}, device rebooted")
+
+        next_sequence[sender] = sequence + 1
+        received[sender] = received.get(sender, 0) + 1
+
+        flag_names = ",".join(name for bit, name in FLAGS if flags & bit) or "-"
+        print(f"{sender} v{version} #{sequence} t={clock_millis / 1000:.0f}s zone {zone} {EVENTS.get(event, event)}: "
+              f"reading {reading / 10:.1f} (var {variance / 10:.1f}, threshold {dryness}) "
+              f"watered {millilitres} ml dose {dose / 1000:.2f} [{flag_names}] "
+              f"received {received[sender]} lost {lost.get(sender, 0)}")
+
+
+if __name__ == "__main__":
+    main()